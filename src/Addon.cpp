@@ -49,11 +49,11 @@ GlobalsType g;
 
 class UpdateThread: public P8PLATFORM::CThread, Lockable
 {
-    time_t _lastDiscover = 0;
     time_t _lastLineup   = 0;
     time_t _lastGuide    = 0;
     time_t _lastRecord   = 0;
     time_t _lastRules    = 0;
+    time_t _lastSnapshot = 0;
 
     bool   _running      = false;
 
@@ -62,7 +62,6 @@ public:
     {
         Lock lock(this);
 
-        _lastDiscover = 0;
         _lastLineup   = 0;
         _lastGuide    = 0;
         _lastRecord   = 0;
@@ -124,44 +123,37 @@ public:
             }
 
             time_t now = time(nullptr);
-            bool updateDiscover = false;
             bool updateLineup   = false;
             bool updateGuide    = false;
             bool updateRecord   = false;
             bool updateRules    = false;
+            bool updateSnapshot = false;
 
-            time_t discover, lineup, guide, recordings, rules;
+            time_t lineup, guide, recordings, rules, snapshot;
             {
                 Lock lock(this);
-                discover   = _lastDiscover;
                 lineup     = _lastLineup;
                 guide      = _lastGuide;
                 recordings = _lastRecord;
                 rules      = _lastRules;
+                snapshot   = _lastSnapshot;
             }
 
             if (g.pvr_hdhr)
             {
+                // Windows Kodi asked for are fetched on every tick, ahead of
+                // whatever else is due.
+                g.pvr_hdhr->UpdateDemandedGuide();
+
                 if (state == 0)
                 {
-                    // Tuner discover
-                    if (now >= discover + g.Settings.deviceDiscoverInterval)
+                    // Device changes from the discovery service, never blocks on the network.
+                    if (g.pvr_hdhr->HandleDiscoveryEvents())
                     {
-                        bool discovered = g.pvr_hdhr->DiscoverTunerDevices();
-                        if (discovered)
-                        {
-                            KODI_LOG(LOG_DEBUG, "PVR::DiscoverDevices returned true, try again");
-                            now = 0;
-                            state = 0;
-                        }
-                        else
-                        {
-                            state = 1;
-                        }
-                        updateDiscover = true;
+                        KODI_LOG(LOG_DEBUG, "PVR::HandleDiscoveryEvents devices changed, update lineup");
+                        lineup = 0;
                     }
-                    else
-                        state = 1;
+                    state = 1;
                 }
 
                 if (state == 1)
@@ -208,16 +200,24 @@ public:
 
                         updateGuide = true;
                     }
+                    else
+                    {
+                        g.pvr_hdhr->UpdateExtendedGuide();
+                    }
+                    if (now >= snapshot + g.Settings.snapshotInterval)
+                    {
+                        g.pvr_hdhr->SaveSnapshot();
+
+                        updateSnapshot = true;
+                    }
                     state = 0;
                 }
             }
 
-            if (updateDiscover || updateLineup || updateGuide || updateRecord || updateRules)
+            if (updateLineup || updateGuide || updateRecord || updateRules || updateSnapshot)
             {
                 Lock lock(this);
 
-                if (updateDiscover)
-                    _lastDiscover = now;
                 if (updateLineup)
                     _lastLineup = now;
                 if (updateGuide)
@@ -226,6 +226,8 @@ public:
                     _lastRecord = now;
                 if (updateRules)
                     _lastRules = now;
+                if (updateSnapshot)
+                    _lastSnapshot = now;
             }
         }
         return nullptr;
@@ -255,6 +257,13 @@ void SetChannelName(int name)
         break;
     }
 }
+void SetHiddenChannels(const std::set<std::string>& hidden)
+{
+    g.Settings.hiddenChannels = hidden;
+    std::shared_ptr<const HiddenChannels> matcher = std::make_shared<HiddenChannels>(hidden);
+    std::atomic_store(&g.Settings.hiddenChannelMatcher, matcher);
+}
+
 void SetProtocol(const char* proto)
 {
     if (strcmp(proto, "TCP") == 0)
@@ -354,7 +363,10 @@ void ADDON_ReadSettings(void)
     readvalue("recordforlive",  g.Settings.recordforlive);
     readvalue("preferred",      g.Settings.preferredDevice);
     readvalue("blacklist",      g.Settings.blacklistDevice);
-    readvalue("hide_ch_no",     g.Settings.hiddenChannels);
+
+    std::set<std::string> hidden;
+    readvalue("hide_ch_no",     hidden);
+    SetHiddenChannels(hidden);
 
     char protocol[64] = "TCP";
     g.XBMC->GetSetting("protocol", protocol);
@@ -401,7 +413,13 @@ ADDON_STATUS ADDON_Create(void* hdl, void* props)
     }
     KODI_LOG(LOG_DEBUG, "Done with new-style Lineup");
 
-    g.pvr_hdhr->Update();
+    // Serve the previous session's state right away, the update thread
+    // and discovery service bring it up to date in the background.
+    if (!g.pvr_hdhr->LoadSnapshot())
+    {
+        g.pvr_hdhr->Update();
+    }
+    g.pvr_hdhr->StartDiscovery();
     g_UpdateThread.CreateThread(false);
 
     g.currentStatus = ADDON_STATUS_OK;
@@ -417,9 +435,20 @@ ADDON_STATUS ADDON_GetStatus()
 
 void ADDON_Destroy()
 {
+    // An update may be sleeping between rate limited guide requests.
+    if (g.pvr_hdhr)
+    {
+        g.pvr_hdhr->Stop();
+    }
     g_UpdateThread.StopThread();
 
+    if (g.pvr_hdhr)
+    {
+        g.pvr_hdhr->SaveSnapshot();
+    }
     delete(g.pvr_hdhr); g.pvr_hdhr = nullptr;
+    // Nothing is left to start ParallelFor.
+    WorkerPool::Shared().Stop();
     delete(g.PVR);      g.PVR = nullptr;
     delete(g.XBMC);     g.XBMC = nullptr;
 
@@ -502,7 +531,8 @@ ADDON_STATUS ADDON_SetSetting(const char *name, const void *value)
     }
     else if (strcmp(name, "hide_ch_no") == 0)
     {
-        g.Settings.hiddenChannels = split_set<std::string>((char*) value);
+        SetHiddenChannels(split_set<std::string>((char*) value));
+        g.pvr_hdhr->InvalidateLineup();
     }
 
     return ADDON_STATUS_OK;
@@ -518,13 +548,13 @@ void OnSystemSleep()
 
 void OnSystemWake()
 {
-    g_UpdateThread.Wake();
-
-    if (g.pvr_hdhr && g.PVR)
+    // Devices may have changed while asleep.  The update thread refreshes
+    // everything, Kodi's thread is not held up by the network.
+    if (g.pvr_hdhr)
     {
-        g.pvr_hdhr->Update();
-        g.PVR->TriggerChannelUpdate();
+        g.pvr_hdhr->TriggerDiscovery();
     }
+    g_UpdateThread.Wake();
 }
 
 void OnPowerSavingActivated()
@@ -28,8 +28,10 @@
 
 #include <libXBMC_addon.h>
 #include <libXBMC_pvr.h>
+#include <memory>
 #include <vector>
 #include <set>
+#include "HiddenChannels.h"
 
 #if defined(_WIN32)
 #define DLL_EXPORT __declspec(dllexport)
@@ -65,6 +67,8 @@ struct SettingsType
     bool extendedGuide          = false;
     int  guideDays              = 1;
     std::set<std::string> hiddenChannels;
+    // Compiled from hiddenChannels, replaced with std::atomic_store
+    std::shared_ptr<const HiddenChannels> hiddenChannelMatcher = std::make_shared<HiddenChannels>();
     std::vector<uint32_t> preferredDevice;
     std::set<uint32_t>    blacklistDevice;
     int udpPort                 = 5000;
@@ -72,8 +76,12 @@ struct SettingsType
     bool recordforlive          = true;
 
     bool usegroups              = false;
-    int deviceDiscoverInterval  = 300;
+    int deviceDiscoverInterval  = 300;       // 5 min   Broadcast discovery
+    int deviceProbeInterval     = 60;        // 1 min   Unicast discovery of known devices
+    int deviceRefreshWorkers    = 4;         // Concurrent discover.json requests
+    int deviceRefreshTimeout    = 5;         // 5 sec   Connection timeout for discover.json
     int lineupUpdateInterval    = 300;       // 5 min   Refresh lineup (local traffic for DLNA devices, remote fetch for legacy)
+    int lineupWorkers           = 4;         // Concurrent lineup.json requests
     int recordUpdateInterval    = 30;        // 30 sec  Refresh list from RECORD engine (local)
     int ruleUpdateInterval      = 3600;      // 1 hour  Refresh recording rules (remote)
     int guideUpdateInterval     = 60;        // 1 min   Check guide for the need to update (remote)
@@ -82,6 +90,11 @@ struct SettingsType
     int guideRandom             = 300;       // ... but up to 5 minutes early
     int guideExtendedEach       = 3600 * 8;  // 8 hours How much is supplied at a time
     int guideExtendedHysteresis = 3600;      // 4 hours max unfilled guide...
+    int guideWorkers            = 4;         // Concurrent guide.php requests
+    int guideRequestInterval    = 250;       // 250 ms  Minimum time between guide.php requests
+    int guideRetries            = 3;         // Retries of a failed guide.php request ...
+    int guideRetryDelay         = 2;         // ... after 2 sec, doubled each time
+    int snapshotInterval        = 600;       // 10 min  Save state for the next start
 
     bool UseLegacyDevices()
     {
@@ -0,0 +1,169 @@
+/*
+ *      Copyright (C) 2017-2019 Matthew Lundberg <matthew.k.lundberg@gmail.com>
+ *      https://github.com/MatthewLundberg/pvr.hdhomerun
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include "ChannelTable.h"
+
+#include <algorithm>
+
+namespace PVRHDHomeRun
+{
+
+size_t ChannelTable::Find(uint32_t id) const
+{
+    auto it = std::lower_bound(_ids.begin(), _ids.end(), id);
+    if (it == _ids.end() || *it != id)
+        return npos;
+    return it - _ids.begin();
+}
+
+size_t ChannelTable::Insert(uint32_t id, bool& added)
+{
+    auto it = std::lower_bound(_ids.begin(), _ids.end(), id);
+    size_t i = it - _ids.begin();
+    if (it != _ids.end() && *it == id)
+    {
+        added = false;
+        return i;
+    }
+
+    // Lineups arrive sorted, so this is almost always an append.
+    _ids.insert(it, id);
+    _flags.insert(_flags.begin() + i, 0);
+    _devices.insert(_devices.begin() + i, 0);
+    _cold.insert(_cold.begin() + i, Cold());
+    added = true;
+    return i;
+}
+
+void ChannelTable::Erase(size_t i)
+{
+    _ids.erase(_ids.begin() + i);
+    _flags.erase(_flags.begin() + i);
+    _devices.erase(_devices.begin() + i);
+    _cold.erase(_cold.begin() + i);
+}
+
+void ChannelTable::Clear()
+{
+    _ids.clear();
+    _flags.clear();
+    _devices.clear();
+    _cold.clear();
+}
+
+bool ChannelTable::AddDevice(size_t i, unsigned slot, const std::string& url)
+{
+    auto& urls = _cold[i].urls;
+    auto it = std::find_if(urls.begin(), urls.end(),
+            [slot](const std::pair<unsigned, std::string>& u) { return u.first == slot; });
+    if (it != urls.end())
+        it->second = url;
+    else
+        urls.emplace_back(slot, url);
+
+    DeviceMask bit = DeviceMask(1) << slot;
+    if (_devices[i] & bit)
+        return false;
+    _devices[i] |= bit;
+    return true;
+}
+
+bool ChannelTable::RemoveDevice(size_t i, unsigned slot)
+{
+    DeviceMask bit = DeviceMask(1) << slot;
+    if (!(_devices[i] & bit))
+        return false;
+    _devices[i] &= ~bit;
+
+    auto& urls = _cold[i].urls;
+    urls.erase(std::remove_if(urls.begin(), urls.end(),
+            [slot](const std::pair<unsigned, std::string>& u) { return u.first == slot; }),
+            urls.end());
+    return true;
+}
+
+std::string ChannelTable::URL(size_t i, unsigned slot) const
+{
+    for (const auto& u : _cold[i].urls)
+    {
+        if (u.first == slot)
+            return u.second;
+    }
+    return "";
+}
+
+void ChannelTable::Save(SnapshotWriter& w, const DeviceRegistry& devices) const
+{
+    w.Put(static_cast<uint32_t>(_ids.size()));
+    for (size_t i = 0; i < _ids.size(); i++)
+    {
+        const auto& cold = _cold[i];
+        w.Put(_ids[i]);
+        w.Put(_flags[i]);
+        w.Put(cold.guidenumber);
+        w.Put(cold.guidename);
+        w.Put(static_cast<uint32_t>(cold.urls.size()));
+        for (const auto& u : cold.urls)
+        {
+            w.Put(devices.TunerAt(u.first)->DeviceID());
+            w.Put(u.second);
+        }
+    }
+}
+
+bool ChannelTable::Load(SnapshotReader& r, const DeviceRegistry& devices)
+{
+    Clear();
+
+    uint32_t count;
+    if (!r.Count(count))
+        return false;
+    for (uint32_t n = 0; n < count; n++)
+    {
+        uint32_t id;
+        uint8_t  flags;
+        std::string number, name;
+        uint32_t urls;
+        if (!(r.Get(id) && r.Get(flags) && r.Get(number) && r.Get(name) && r.Count(urls)))
+            return false;
+
+        bool added;
+        auto i = Insert(id, added);
+        _flags[i] = flags;
+        SetNames(i, number, name);
+
+        for (uint32_t u = 0; u < urls; u++)
+        {
+            uint32_t    deviceid;
+            std::string url;
+            if (!r.Get(deviceid) || !r.Get(url))
+                return false;
+
+            int slot = devices.Slot(deviceid);
+            if (slot < 0)
+                return false;
+            AddDevice(i, slot, url);
+        }
+    }
+    return true;
+}
+
+} // namespace PVRHDHomeRun
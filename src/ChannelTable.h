@@ -0,0 +1,120 @@
+#pragma once
+/*
+ *      Copyright (C) 2017-2019 Matthew Lundberg <matthew.k.lundberg@gmail.com>
+ *      https://github.com/MatthewLundberg/pvr.hdhomerun
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+
+#include "DeviceRegistry.h"
+#include "Snapshot.h"
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace PVRHDHomeRun
+{
+
+// The merged lineup, sorted by GuideNumber::ID().  Fields visited on every
+// lineup pass are kept in parallel arrays, strings and stream URLs in a
+// side table.  Receiving devices are a DeviceRegistry::DeviceMask.
+//
+// Not locked, PVR_HDHR holds _pvr_lock.
+class ChannelTable
+{
+public:
+    typedef DeviceRegistry::DeviceMask DeviceMask;
+
+    static const size_t npos = static_cast<size_t>(-1);
+
+    enum Flag : uint8_t {
+        HD       = 1,
+        DRM      = 2,
+        FAVORITE = 4
+    };
+
+    size_t Size() const
+    {
+        return _ids.size();
+    }
+    size_t Find(uint32_t id) const;
+    // Index of the channel, which is added if not present.
+    size_t Insert(uint32_t id, bool& added);
+    void   Erase(size_t index);
+    void   Clear();
+
+    uint32_t ID(size_t i) const
+    {
+        return _ids[i];
+    }
+    uint8_t Flags(size_t i) const
+    {
+        return _flags[i];
+    }
+    bool Has(size_t i, Flag f) const
+    {
+        return (_flags[i] & f) != 0;
+    }
+    void SetFlags(size_t i, uint8_t flags)
+    {
+        _flags[i] = flags;
+    }
+    DeviceMask Devices(size_t i) const
+    {
+        return _devices[i];
+    }
+
+    const std::string& Number(size_t i) const
+    {
+        return _cold[i].guidenumber;
+    }
+    const std::string& Name(size_t i) const
+    {
+        return _cold[i].guidename;
+    }
+    void SetNames(size_t i, const std::string& number, const std::string& name)
+    {
+        _cold[i].guidenumber = number;
+        _cold[i].guidename   = name;
+    }
+
+    // True if the device is new for this channel, the URL is updated regardless.
+    bool        AddDevice(size_t i, unsigned slot, const std::string& url);
+    bool        RemoveDevice(size_t i, unsigned slot);
+    std::string URL(size_t i, unsigned slot) const;
+
+    // Devices are saved by ID, and looked up in the registry on load.
+    void Save(SnapshotWriter&, const DeviceRegistry&) const;
+    bool Load(SnapshotReader&, const DeviceRegistry&);
+
+private:
+    struct Cold
+    {
+        std::string guidenumber;
+        std::string guidename;
+        std::vector<std::pair<unsigned, std::string>> urls; // slot, URL
+    };
+
+    std::vector<uint32_t>   _ids;
+    std::vector<uint8_t>    _flags;
+    std::vector<DeviceMask> _devices;
+    std::vector<Cold>       _cold;
+};
+
+} // namespace PVRHDHomeRun
@@ -35,12 +35,46 @@ TunerDevice* New_TunerDevice(const hdhomerun_discover_device_t* d)
     t->Refresh(d);
     return t;
 }
+TunerDevice* New_TunerDevice(const hdhomerun_discover_device_t& d, const Json::Value& discover)
+{
+    auto t = new TunerDevice();
+    t->Refresh(d, discover);
+    return t;
+}
 StorageDevice* New_StorageDevice(const hdhomerun_discover_device_t* d)
 {
     auto t = new StorageDevice();
     t->Refresh(d);
     return t;
 }
+StorageDevice* New_StorageDevice(const hdhomerun_discover_device_t& d, const Json::Value& discover)
+{
+    auto t = new StorageDevice();
+    t->Refresh(d, discover);
+    return t;
+}
+
+bool FetchDiscoverData(const char* baseURL, Json::Value& discover, int timeout)
+{
+    std::string discoverResults;
+    std::string url{baseURL};
+    url.append("/discover.json");
+
+    if (!GetFileContents(url, discoverResults, timeout))
+    {
+        KODI_LOG(LOG_ERROR, "Cannot get discover data from %s", url.c_str());
+        return false;
+    }
+
+    std::string err;
+    if (!StringToJson(discoverResults, discover, err))
+    {
+        KODI_LOG(LOG_ERROR, "Cannot parse JSON value returned from %s - %s", url.c_str(), err.c_str());
+        discover = Json::Value();
+        return false;
+    }
+    return true;
+}
 
 Tuner::Tuner(TunerDevice* box, unsigned int index)
     : _box(box)
@@ -61,16 +95,20 @@ void Device::Refresh(const hdhomerun_discover_device_t* d)
     if (d)
         _discover_device = *d;
 
-    std::string discoverResults;
-    std::string baseURL{BaseURL()};
-    if (GetFileContents(baseURL + "/discover.json", discoverResults))
+    Json::Value discoverJson;
+    if (FetchDiscoverData(BaseURL(), discoverJson))
     {
-        Json::Value discoverJson;
-        std::string err;
-        if (StringToJson(discoverResults, discoverJson, err))
-        {
-            _parse_discover_data(discoverJson);
-        }
+        _parse_discover_data(discoverJson);
+    }
+}
+void Device::Refresh(const hdhomerun_discover_device_t& d, const Json::Value& discover)
+{
+    _discover_device = d;
+
+    // Keep the prior discover data if the fetch failed.
+    if (!discover.isNull())
+    {
+        _parse_discover_data(discover);
     }
 }
 const char* Device::BaseURL()
@@ -153,6 +191,18 @@ void TunerDevice::_parse_discover_data(const Json::Value& json)
     _tunercount = json["TunerCount"].asUInt();
     _legacy     = json["Legacy"].asBool();
 
+    _create_tuners();
+
+    KODI_LOG(LOG_DEBUG, "HDR ID %08x LineupURL %s Tuner Count %d Legacy %d",
+            _discover_device.device_id,
+            _lineupURL.c_str(),
+            _tunercount,
+            _legacy
+    );
+}
+
+void TunerDevice::_create_tuners()
+{
     // We only need the device-level info for TCP
     if (g.Settings.protocol == SettingsType::UDP)
     {
@@ -162,12 +212,64 @@ void TunerDevice::_parse_discover_data(const Json::Value& json)
             _tuners.push_back(std::unique_ptr<Tuner>(new Tuner(this, index)));
         }
     }
-    KODI_LOG(LOG_DEBUG, "HDR ID %08x LineupURL %s Tuner Count %d Legacy %d",
-            _discover_device.device_id,
-            _lineupURL.c_str(),
-            _tunercount,
-            _legacy
-    );
+}
+
+void Device::Save(SnapshotWriter& w) const
+{
+    const auto& d = _discover_device;
+    w.Put(d.ip_addr);
+    w.Put(d.device_type);
+    w.Put(d.device_id);
+    w.Put(d.tuner_count);
+    w.Put(d.is_legacy);
+    w.Put(d.device_auth, sizeof(d.device_auth));
+    w.Put(d.base_url, sizeof(d.base_url));
+}
+bool Device::Load(SnapshotReader& r)
+{
+    auto& d = _discover_device;
+    if (!(r.Get(d.ip_addr) && r.Get(d.device_type) && r.Get(d.device_id)
+            && r.Get(d.tuner_count) && r.Get(d.is_legacy)
+            && r.Get(d.device_auth, sizeof(d.device_auth))
+            && r.Get(d.base_url, sizeof(d.base_url))))
+        return false;
+
+    d.device_auth[sizeof(d.device_auth) - 1] = 0;
+    d.base_url[sizeof(d.base_url) - 1] = 0;
+    return true;
+}
+
+void StorageDevice::Save(SnapshotWriter& w) const
+{
+    Device::Save(w);
+    w.Put(_storageID);
+    w.Put(_storageURL);
+    w.Put(_freeSpace);
+}
+bool StorageDevice::Load(SnapshotReader& r)
+{
+    return Device::Load(r)
+            && r.Get(_storageID)
+            && r.Get(_storageURL)
+            && r.Get(_freeSpace);
+}
+
+void TunerDevice::Save(SnapshotWriter& w) const
+{
+    Device::Save(w);
+    w.Put(_lineupURL);
+    w.Put(static_cast<uint32_t>(_tunercount));
+    w.Put(_legacy);
+}
+bool TunerDevice::Load(SnapshotReader& r)
+{
+    uint32_t tunercount;
+    if (!(Device::Load(r) && r.Get(_lineupURL) && r.Get(tunercount) && r.Get(_legacy)))
+        return false;
+
+    _tunercount = tunercount;
+    _create_tuners();
+    return true;
 }
 
 uint32_t Device::LocalIP() const
@@ -20,6 +20,7 @@
  *
  */
 
+#include "Snapshot.h"
 #include <hdhomerun.h>
 #include <string>
 #include <memory>
@@ -41,12 +42,20 @@ public:
     virtual ~Device() = default;
 
     void Refresh(const hdhomerun_discover_device_t* d = nullptr);
+    void Refresh(const hdhomerun_discover_device_t& d, const Json::Value& discover);
     const char* BaseURL();
     uint32_t LocalIP() const;
     uint32_t IP() const
     {
         return _discover_device.ip_addr;
     }
+    const hdhomerun_discover_device_t& DiscoverDevice() const
+    {
+        return _discover_device;
+    }
+
+    virtual void Save(SnapshotWriter&) const;
+    virtual bool Load(SnapshotReader&);
 
 protected:
     hdhomerun_discover_device_t _discover_device;
@@ -64,7 +73,7 @@ private:
 
     std::string _storageID;
     std::string _storageURL;
-    uint64_t    _freeSpace;
+    uint64_t    _freeSpace = 0;
 
     friend bool operator<(const StorageDevice&, const StorageDevice&);
     friend bool operator==(const StorageDevice&, const StorageDevice&);
@@ -81,11 +90,15 @@ public:
     {
         return _freeSpace;
     }
+
+    void Save(SnapshotWriter&) const override;
+    bool Load(SnapshotReader&) override;
 };
 bool operator<(const StorageDevice&, const StorageDevice&);
 bool operator==(const StorageDevice&, const StorageDevice&);
 
 StorageDevice* New_StorageDevice(const hdhomerun_discover_device_t* d);
+StorageDevice* New_StorageDevice(const hdhomerun_discover_device_t& d, const Json::Value& discover);
 
 // The tuner box has an ID, lineup, guide, and one or more tuners.
 class Tuner;
@@ -113,14 +126,18 @@ public:
         return _lineupURL;
     }
 
+    void Save(SnapshotWriter&) const override;
+    bool Load(SnapshotReader&) override;
+
 private:
     void _parse_discover_data(const Json::Value&) override;
+    void _create_tuners();
 
 
     // Discover Data
     std::string                 _lineupURL;
-    unsigned int                _tunercount;
-    bool                        _legacy;
+    unsigned int                _tunercount = 0;
+    bool                        _legacy     = false;
 
     std::vector<std::unique_ptr<Tuner>> _tuners;
 public:
@@ -131,6 +148,21 @@ bool operator<(const TunerDevice&, const TunerDevice&);
 
 
 TunerDevice* New_TunerDevice(const hdhomerun_discover_device_t* d);
+TunerDevice* New_TunerDevice(const hdhomerun_discover_device_t& d, const Json::Value& discover);
+
+// Result of a discovery broadcast, with the device's discover.json
+// fetched separately so that it can be done without holding locks.
+struct DiscoveredDevice
+{
+    DiscoveredDevice(const hdhomerun_discover_device_t& d)
+        : device(d)
+    {}
+
+    hdhomerun_discover_device_t device;
+    Json::Value                 discover;
+};
+
+bool FetchDiscoverData(const char* baseURL, Json::Value& discover, int timeout = 0);
 
 class TunerSet
 {
@@ -138,48 +170,6 @@ public:
     virtual std::string IDString() const = 0;
     virtual std::string AuthString() const = 0;
     virtual size_t      DeviceCount() const = 0;
-    virtual std::set<TunerDevice*>::iterator begin() = 0;
-    virtual std::set<TunerDevice*>::iterator end() = 0;
-};
-
-template<typename T>
-class HasTunerSet : public TunerSet
-{
-public:
-    std::string IDString() const
-    {
-        auto t = static_cast<const T*>(this);
-        std::stringstream devices;
-        devices << std::hex;
-        std::transform(t->_tuner_devices.begin(), t->_tuner_devices.end(),
-                std::ostream_iterator<uint32_t>(devices, " "),
-                [](const TunerDevice* t) -> uint32_t {return t->DeviceID();});
-        return devices.str();
-    }
-    std::string AuthString() const
-    {
-        auto t = static_cast<const T*>(this);
-        std::stringstream auth;
-        std::transform(t->_tuner_devices.begin(), t->_tuner_devices.end(),
-                std::ostream_iterator<std::string>(auth),
-                [](const TunerDevice* t) -> std::string {return t->Auth();});
-        return auth.str();
-    }
-    size_t DeviceCount() const
-    {
-        auto t = static_cast<const T*>(this);
-        return t->_tuner_devices.size();
-    }
-    std::set<TunerDevice*>::iterator begin()
-    {
-        auto t = static_cast<T*>(this);
-        return t->_tuner_devices.begin();
-    }
-    std::set<TunerDevice*>::iterator end()
-    {
-        auto t = static_cast<T*>(this);
-        return t->_tuner_devices.end();
-    }
 };
 
 class Tuner
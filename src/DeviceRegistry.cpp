@@ -0,0 +1,276 @@
+/*
+ *      Copyright (C) 2017-2019 Matthew Lundberg <matthew.k.lundberg@gmail.com>
+ *      https://github.com/MatthewLundberg/pvr.hdhomerun
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include "DeviceRegistry.h"
+#include "Addon.h"
+#include "Utils.h"
+
+#include <algorithm>
+#include <iterator>
+#include <sstream>
+
+namespace PVRHDHomeRun
+{
+
+DeviceRegistry::TunerHandle DeviceRegistry::FindTuner(uint32_t id) const
+{
+    auto it = _tuners.find(id);
+    if (it == _tuners.end())
+        return nullptr;
+    return it->second;
+}
+
+bool DeviceRegistry::AddTuner(TunerDevice* t)
+{
+    auto id = t->DeviceID();
+    auto it = _slots.find(id);
+    unsigned slot;
+    if (it != _slots.end())
+    {
+        slot = it->second;
+    }
+    else
+    {
+        slot = 0;
+        while (slot < MaxTuners && _slot_tuners[slot])
+            slot ++;
+        if (slot == MaxTuners)
+        {
+            KODI_LOG(LOG_ERROR, "Too many tuner devices, ignoring %08x", id);
+            delete t;
+            return false;
+        }
+        _slots[id] = slot;
+    }
+
+    _slot_tuners[slot] = t;
+    _tuners[id] = TunerHandle(t);
+    return true;
+}
+
+int DeviceRegistry::Slot(uint32_t id) const
+{
+    auto it = _slots.find(id);
+    if (it == _slots.end())
+        return -1;
+    return it->second;
+}
+
+DeviceRegistry::TunerHandle DeviceRegistry::RemoveTuner(uint32_t id)
+{
+    auto it = _tuners.find(id);
+    if (it == _tuners.end())
+        return nullptr;
+
+    auto t = it->second;
+    _tuners.erase(it);
+    _channels.erase(id);
+
+    auto sit = _slots.find(id);
+    if (sit != _slots.end())
+    {
+        _slot_tuners[sit->second] = nullptr;
+        _slots.erase(sit);
+    }
+    return t;
+}
+
+std::string DeviceRegistry::_storage_key(StorageDevice* s)
+{
+    const auto& id = s->StorageID();
+    if (id.size())
+        return id;
+    return s->BaseURL();
+}
+
+DeviceRegistry::StorageHandle DeviceRegistry::FindStorage(const std::string& storageID) const
+{
+    auto it = _storage.find(storageID);
+    if (it == _storage.end())
+        return nullptr;
+    return it->second;
+}
+
+DeviceRegistry::StorageHandle DeviceRegistry::FindStorageURL(const std::string& baseURL) const
+{
+    auto it = _storage_urls.find(baseURL);
+    if (it == _storage_urls.end())
+        return nullptr;
+    return FindStorage(it->second);
+}
+
+void DeviceRegistry::AddStorage(StorageDevice* s)
+{
+    auto key = _storage_key(s);
+    _storage[key] = StorageHandle(s);
+    _storage_urls[s->BaseURL()] = key;
+}
+
+void DeviceRegistry::RefreshStorage(const hdhomerun_discover_device_t& dd, const Json::Value& discover)
+{
+    auto it = _storage_urls.find(dd.base_url);
+    if (it == _storage_urls.end())
+        return;
+
+    auto s = FindStorage(it->second);
+    if (!s)
+        return;
+
+    s->Refresh(dd, discover);
+
+    // The storage ID is not known until discover.json has been read.
+    auto key = _storage_key(s.get());
+    if (key != it->second)
+    {
+        _storage.erase(it->second);
+        _storage[key] = s;
+        it->second = key;
+    }
+}
+
+DeviceRegistry::StorageHandle DeviceRegistry::RemoveStorageURL(const std::string& baseURL)
+{
+    auto it = _storage_urls.find(baseURL);
+    if (it == _storage_urls.end())
+        return nullptr;
+
+    auto s = FindStorage(it->second);
+    _storage.erase(it->second);
+    _storage_urls.erase(it);
+    return s;
+}
+
+void DeviceRegistry::AddChannel(uint32_t id, uint32_t channel)
+{
+    _channels[id].insert(channel);
+}
+
+void DeviceRegistry::RemoveChannel(uint32_t id, uint32_t channel)
+{
+    auto it = _channels.find(id);
+    if (it != _channels.end())
+    {
+        it->second.erase(channel);
+    }
+}
+
+const std::set<uint32_t>& DeviceRegistry::Channels(uint32_t id) const
+{
+    static const std::set<uint32_t> empty;
+
+    auto it = _channels.find(id);
+    if (it == _channels.end())
+        return empty;
+    return it->second;
+}
+
+void DeviceRegistry::Clear()
+{
+    _tuners.clear();
+    _slots.clear();
+    std::fill(std::begin(_slot_tuners), std::end(_slot_tuners), nullptr);
+    _storage.clear();
+    _storage_urls.clear();
+    _channels.clear();
+}
+
+void DeviceRegistry::Save(SnapshotWriter& w) const
+{
+    w.Put(static_cast<uint32_t>(_tuners.size()));
+    for (const auto& t : _tuners)
+    {
+        t.second->Save(w);
+    }
+    w.Put(static_cast<uint32_t>(_storage.size()));
+    for (const auto& s : _storage)
+    {
+        s.second->Save(w);
+    }
+}
+
+bool DeviceRegistry::Load(SnapshotReader& r)
+{
+    uint32_t count;
+    if (!r.Count(count))
+        return false;
+    for (uint32_t i=0; i<count; i++)
+    {
+        std::unique_ptr<TunerDevice> t(new TunerDevice());
+        if (!t->Load(r) || !AddTuner(t.release()))
+            return false;
+    }
+
+    if (!r.Count(count))
+        return false;
+    for (uint32_t i=0; i<count; i++)
+    {
+        std::unique_ptr<StorageDevice> s(new StorageDevice());
+        if (!s->Load(r))
+            return false;
+        AddStorage(s.release());
+    }
+    return true;
+}
+
+std::vector<TunerDevice*> DeviceRegistry::_sorted_tuners(DeviceMask mask) const
+{
+    std::vector<TunerDevice*> tuners;
+    ForEachSlot(mask, [&](unsigned slot) {
+        if (_slot_tuners[slot])
+            tuners.push_back(_slot_tuners[slot]);
+    });
+    std::sort(tuners.begin(), tuners.end(),
+            [](const TunerDevice* a, const TunerDevice* b) { return a->DeviceID() < b->DeviceID(); });
+    return tuners;
+}
+
+std::string DeviceRegistry::IDString(DeviceMask mask) const
+{
+    std::stringstream devices;
+    devices << std::hex;
+    for (auto t : _sorted_tuners(mask))
+    {
+        devices << t->DeviceID() << " ";
+    }
+    return devices.str();
+}
+
+std::string DeviceRegistry::AuthString(DeviceMask mask) const
+{
+    std::stringstream auth;
+    for (auto t : _sorted_tuners(mask))
+    {
+        auth << t->Auth();
+    }
+    return auth.str();
+}
+
+size_t DeviceRegistry::DeviceCount(DeviceMask mask) const
+{
+    size_t count = 0;
+    ForEachSlot(mask, [&](unsigned slot) {
+        if (_slot_tuners[slot])
+            count ++;
+    });
+    return count;
+}
+
+} // namespace PVRHDHomeRun
@@ -0,0 +1,162 @@
+#pragma once
+/*
+ *      Copyright (C) 2017-2019 Matthew Lundberg <matthew.k.lundberg@gmail.com>
+ *      https://github.com/MatthewLundberg/pvr.hdhomerun
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include "Device.h"
+#include <memory>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace PVRHDHomeRun
+{
+
+// Owns all tuner and storage devices.  Tuners are keyed by device ID,
+// storage by storage ID (or base URL until discover.json has been read).
+// Handles are reference counted, so a device which goes away remains valid
+// for anyone still holding a handle to it.
+//
+// Each tuner also holds a slot, its bit in a DeviceMask, for as long as it
+// is registered.
+//
+// Not locked, PVR_HDHR holds _pvr_lock.
+class DeviceRegistry : public TunerSet
+{
+public:
+    typedef std::shared_ptr<TunerDevice>   TunerHandle;
+    typedef std::shared_ptr<StorageDevice> StorageHandle;
+    typedef std::unordered_map<uint32_t, TunerHandle>      TunerMap;
+    typedef std::unordered_map<std::string, StorageHandle> StorageMap;
+    typedef uint64_t DeviceMask;
+
+    static const unsigned MaxTuners = 64;
+
+    DeviceRegistry() = default;
+    DeviceRegistry(const DeviceRegistry&) = delete;
+    DeviceRegistry& operator=(const DeviceRegistry&) = delete;
+
+    // Tuners
+    TunerHandle FindTuner(uint32_t id) const;
+    // Takes ownership, the device is deleted if every slot is in use.
+    bool        AddTuner(TunerDevice*);
+    TunerHandle RemoveTuner(uint32_t id);
+    int          Slot(uint32_t id) const; // -1 if not registered
+    TunerDevice* TunerAt(unsigned slot) const
+    {
+        return _slot_tuners[slot];
+    }
+    const TunerMap& Tuners() const
+    {
+        return _tuners;
+    }
+
+    // Storage
+    StorageHandle FindStorage(const std::string& storageID) const;
+    StorageHandle FindStorageURL(const std::string& baseURL) const;
+    void          AddStorage(StorageDevice*);
+    void          RefreshStorage(const hdhomerun_discover_device_t&, const Json::Value& discover);
+    StorageHandle RemoveStorageURL(const std::string& baseURL);
+    const StorageMap& Storage() const
+    {
+        return _storage;
+    }
+
+    // Reverse index of the channels received by each tuner
+    void AddChannel(uint32_t id, uint32_t channel);
+    void RemoveChannel(uint32_t id, uint32_t channel);
+    const std::set<uint32_t>& Channels(uint32_t id) const;
+
+    void Clear();
+
+    // Channel index is not saved, it is rebuilt with the lineup.
+    void Save(SnapshotWriter&) const;
+    bool Load(SnapshotReader&);
+
+    // TunerSet
+    std::string IDString() const override
+    {
+        return IDString(~DeviceMask(0));
+    }
+    std::string AuthString() const override
+    {
+        return AuthString(~DeviceMask(0));
+    }
+    size_t      DeviceCount() const override
+    {
+        return _tuners.size();
+    }
+
+    // Limited to the tuners in the mask
+    std::string IDString(DeviceMask) const;
+    std::string AuthString(DeviceMask) const;
+    size_t      DeviceCount(DeviceMask) const;
+
+    template<typename F>
+    static void ForEachSlot(DeviceMask mask, F f)
+    {
+        for (unsigned slot = 0; mask; slot++, mask >>= 1)
+        {
+            if (mask & 1)
+                f(slot);
+        }
+    }
+
+private:
+    std::vector<TunerDevice*> _sorted_tuners(DeviceMask) const;
+    static std::string _storage_key(StorageDevice*);
+
+    TunerMap   _tuners;
+    std::unordered_map<uint32_t, unsigned>               _slots;        // device ID -> slot
+    TunerDevice*                                         _slot_tuners[MaxTuners] = {};
+    StorageMap _storage;
+    std::unordered_map<std::string, std::string>         _storage_urls; // base URL -> key
+    std::unordered_map<uint32_t, std::set<uint32_t>>     _channels;
+};
+
+// The tuners in a DeviceMask, for requests made on behalf of one channel.
+class TunerSubset : public TunerSet
+{
+public:
+    TunerSubset(const DeviceRegistry& devices, DeviceRegistry::DeviceMask mask)
+        : _devices(devices)
+        , _mask(mask)
+    {}
+
+    std::string IDString() const override
+    {
+        return _devices.IDString(_mask);
+    }
+    std::string AuthString() const override
+    {
+        return _devices.AuthString(_mask);
+    }
+    size_t      DeviceCount() const override
+    {
+        return _devices.DeviceCount(_mask);
+    }
+
+private:
+    const DeviceRegistry&      _devices;
+    DeviceRegistry::DeviceMask _mask;
+};
+
+} // namespace PVRHDHomeRun
@@ -0,0 +1,265 @@
+/*
+ *      Copyright (C) 2017-2019 Matthew Lundberg <matthew.k.lundberg@gmail.com>
+ *      https://github.com/MatthewLundberg/pvr.hdhomerun
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include "Discovery.h"
+#include "Addon.h"
+#include "Utils.h"
+
+#include <cstring>
+#include <set>
+
+namespace PVRHDHomeRun
+{
+
+// A device must be absent from this many consecutive broadcasts to be removed.
+static const int MissedBroadcastLimit = 2;
+
+DiscoveryService::~DiscoveryService()
+{
+    StopThread();
+
+    Lock lock(_socket_lock);
+    if (_ds)
+        hdhomerun_discover_destroy(_ds);
+    _ds = nullptr;
+}
+
+std::string DiscoveryService::_key(const hdhomerun_discover_device_t& d)
+{
+    if (d.device_type == HDHOMERUN_DEVICE_TYPE_STORAGE)
+        return d.base_url;
+
+    char id[16];
+    sprintf(id, "%08x", d.device_id);
+    return id;
+}
+
+bool DiscoveryService::_same(const hdhomerun_discover_device_t& a, const hdhomerun_discover_device_t& b)
+{
+    return a.ip_addr     == b.ip_addr
+        && a.device_type == b.device_type
+        && a.device_id   == b.device_id
+        && a.tuner_count == b.tuner_count
+        && a.is_legacy   == b.is_legacy
+        && !strcmp(a.device_auth, b.device_auth)
+        && !strcmp(a.base_url, b.base_url);
+}
+
+void DiscoveryService::Broadcast(std::vector<DiscoveryEvent>& events)
+{
+    Lock lock(_socket_lock);
+
+    // Events queued by the thread precede this broadcast.
+    TakeEvents(events);
+    _broadcast(events);
+}
+
+bool DiscoveryService::TakeEvents(std::vector<DiscoveryEvent>& events)
+{
+    Lock lock(_event_lock);
+
+    if (_events.empty())
+        return false;
+
+    events.insert(events.end(), _events.begin(), _events.end());
+    _events.clear();
+    return true;
+}
+
+void DiscoveryService::Trigger()
+{
+    Lock lock(_event_lock);
+    _trigger = true;
+}
+
+void DiscoveryService::Seed(const hdhomerun_discover_device_t& d)
+{
+    Lock lock(_socket_lock);
+
+    Known k;
+    k.device = d;
+    _known[_key(d)] = k;
+}
+
+void DiscoveryService::_queue(std::vector<DiscoveryEvent>& events)
+{
+    if (events.empty())
+        return;
+
+    Lock lock(_event_lock);
+    _events.insert(_events.end(), events.begin(), events.end());
+}
+
+void* DiscoveryService::Process()
+{
+    for (;;)
+    {
+        P8PLATFORM::CThread::Sleep(1000);
+        if (IsStopped())
+        {
+            break;
+        }
+
+        bool trigger;
+        {
+            Lock lock(_event_lock);
+            trigger  = _trigger;
+            _trigger = false;
+        }
+
+        time_t now = time(nullptr);
+        std::vector<DiscoveryEvent> events;
+
+        Lock lock(_socket_lock);
+        if (trigger || now >= _lastBroadcast + g.Settings.deviceDiscoverInterval)
+        {
+            _broadcast(events);
+        }
+        else if (now >= _lastProbe + g.Settings.deviceProbeInterval)
+        {
+            _probe(events);
+        }
+        // Queue while holding the socket lock, so that a synchronous
+        // Broadcast() always sees these events before its own.
+        _queue(events);
+    }
+    return nullptr;
+}
+
+void DiscoveryService::_broadcast(std::vector<DiscoveryEvent>& events)
+{
+    // _socket_lock held
+    _lastBroadcast = time(nullptr);
+    _lastProbe     = _lastBroadcast;
+
+    _find(0, true, events);
+}
+
+void DiscoveryService::_probe(std::vector<DiscoveryEvent>& events)
+{
+    // _socket_lock held
+    _lastProbe = time(nullptr);
+
+    std::set<uint32_t> ips;
+    for (const auto& k : _known)
+    {
+        ips.insert(k.second.device.ip_addr);
+    }
+    for (auto ip : ips)
+    {
+        _find(ip, false, events);
+    }
+}
+
+bool DiscoveryService::_find(uint32_t target_ip, bool broadcast, std::vector<DiscoveryEvent>& events)
+{
+    // _socket_lock held
+    if (!_ds)
+    {
+        _ds = hdhomerun_discover_create(nullptr);
+        if (!_ds)
+        {
+            KODI_LOG(LOG_ERROR, "Cannot create HDHomeRun discovery socket");
+            return false;
+        }
+    }
+
+    struct hdhomerun_discover_device_t found[64];
+    int count = hdhomerun_discover_find_devices(
+            _ds,
+            target_ip,
+            HDHOMERUN_DEVICE_TYPE_WILDCARD,
+            HDHOMERUN_DEVICE_ID_WILDCARD,
+            found,
+            64
+            );
+
+    if (count < 0)
+    {
+        KODI_LOG(LOG_ERROR, "HDHomeRun discovery failed for %s", target_ip ? FormatIP(target_ip).c_str() : "broadcast");
+        // Reopen the socket on the next attempt, local interfaces may have changed.
+        hdhomerun_discover_destroy(_ds);
+        _ds = nullptr;
+        return false;
+    }
+
+    if (broadcast)
+    {
+        KODI_LOG(LOG_DEBUG, "DiscoveryService broadcast found %d devices", count);
+    }
+
+    if (broadcast && count == 0)
+    {
+        // Sometimes no devices are found when waking from sleep, causing a
+        // lot of unnecessary network traffic as they are rediscovered.
+        return false;
+    }
+
+    std::set<std::string> seen;
+    for (int i=0; i<count; i++)
+    {
+        const auto& d  = found[i];
+        auto        key = _key(d);
+        seen.insert(key);
+
+        auto it = _known.find(key);
+        if (it == _known.end())
+        {
+            Known k;
+            k.device = d;
+            _known[key] = k;
+            events.push_back({DiscoveryEvent::ADDED, d});
+        }
+        else
+        {
+            auto& k = it->second;
+            bool changed = !_same(k.device, d);
+            k.device = d;
+            k.missed = 0;
+
+            // Every broadcast refreshes all devices, probes only report changes.
+            if (broadcast || changed)
+            {
+                events.push_back({DiscoveryEvent::UPDATED, d});
+            }
+        }
+    }
+
+    if (broadcast)
+    {
+        auto it = _known.begin();
+        while (it != _known.end())
+        {
+            auto& k = it->second;
+            if (seen.find(it->first) == seen.end() && ++k.missed >= MissedBroadcastLimit)
+            {
+                events.push_back({DiscoveryEvent::REMOVED, k.device});
+                it = _known.erase(it);
+            }
+            else
+                it ++;
+        }
+    }
+
+    return count > 0;
+}
+
+} // namespace PVRHDHomeRun
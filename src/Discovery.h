@@ -0,0 +1,96 @@
+#pragma once
+/*
+ *      Copyright (C) 2017-2019 Matthew Lundberg <matthew.k.lundberg@gmail.com>
+ *      https://github.com/MatthewLundberg/pvr.hdhomerun
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include "Lockable.h"
+#include <hdhomerun.h>
+#include <p8-platform/threads/threads.h>
+#include <ctime>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace PVRHDHomeRun
+{
+
+struct DiscoveryEvent
+{
+    enum Type {
+        ADDED,
+        UPDATED,
+        REMOVED
+    };
+
+    Type                        type;
+    hdhomerun_discover_device_t device;
+};
+
+// Owns a persistent discovery socket.  The thread broadcasts every
+// deviceDiscoverInterval and unicasts to known devices in between, queueing
+// device changes to be picked up by PVR_HDHR with TakeEvents().
+class DiscoveryService : public P8PLATFORM::CThread
+{
+public:
+    DiscoveryService() = default;
+    virtual ~DiscoveryService();
+
+    DiscoveryService(const DiscoveryService&) = delete;
+    DiscoveryService& operator=(const DiscoveryService&) = delete;
+
+    // Synchronous broadcast.  Any queued events are returned first.
+    void Broadcast(std::vector<DiscoveryEvent>&);
+    // Does not block on a discovery round in progress.
+    bool TakeEvents(std::vector<DiscoveryEvent>&);
+    // Request a broadcast from the thread as soon as possible.
+    void Trigger();
+    // Treat a device restored from a snapshot as known, so that it is
+    // removed if it does not answer broadcasts.
+    void Seed(const hdhomerun_discover_device_t&);
+
+    void* Process() override;
+
+private:
+    struct Known
+    {
+        hdhomerun_discover_device_t device;
+        int                         missed = 0;
+    };
+
+    void _broadcast(std::vector<DiscoveryEvent>&);
+    void _probe(std::vector<DiscoveryEvent>&);
+    bool _find(uint32_t target_ip, bool broadcast, std::vector<DiscoveryEvent>&);
+    void _queue(std::vector<DiscoveryEvent>&);
+    static std::string _key(const hdhomerun_discover_device_t&);
+    static bool _same(const hdhomerun_discover_device_t&, const hdhomerun_discover_device_t&);
+
+    // Lock order: _socket_lock, then _event_lock
+    Lockable                     _socket_lock;
+    hdhomerun_discover_t*        _ds = nullptr;
+    std::map<std::string, Known> _known;
+    time_t                       _lastBroadcast = 0;
+    time_t                       _lastProbe     = 0;
+
+    Lockable                     _event_lock;
+    std::vector<DiscoveryEvent>  _events;
+    bool                         _trigger = false;
+};
+
+} // namespace PVRHDHomeRun
@@ -38,28 +38,36 @@ Entry::Entry(const Json::Value& v)
     _posterURL       = v["PosterURL"].asString();
     _seriesID        = v["SeriesID"].asString();
 
-    // Remove this hack once the timer rules are sent to Kodi.
     bool recording = v.isMember("RecordingRule") && v["RecordingRule"].asBool();
+    SetTitle(v["Title"].asString(), recording);
+
+    ParseEpisodeNumber();
+
+    _genre = GetGenreType(v["Filter"]);
+}
+
+// Remove this hack once the timer rules are sent to Kodi.
+void Entry::SetTitle(const std::string& title, bool recording)
+{
+    _marked = recording;
     if (recording)
-    {
-        _title = std::string("* ") + v["Title"].asString();
-    }
+        _title = std::string("* ") + title;
     else
-    {
-        _title = v["Title"].asString();
-    }
+        _title = title;
+}
 
-    if (_episodenumber[0] == 'S') {
-        auto e = _episodenumber.find('E');
+void Entry::ParseEpisodeNumber()
+{
+    const std::string& episodenumber = _episodenumber;
+    if (episodenumber[0] == 'S') {
+        auto e = episodenumber.find('E');
         if (e != std::string::npos) {
-            auto season  = _episodenumber.substr(1, e);
-            auto episode = _episodenumber.substr(e+1);
+            auto season  = episodenumber.substr(1, e);
+            auto episode = episodenumber.substr(e+1);
             _season  = std::stoi(season);
             _episode = std::stoi(episode);
         }
     }
-
-    _genre = GetGenreType(v["Filter"]);
 }
 
 time_t Entry::StartTime() const
@@ -72,9 +80,79 @@ time_t Entry::EndTime() const
     return _endtime;
 }
 
-size_t Entry::Length() const
+namespace
+{
+// FNV-1a
+class Hasher
+{
+public:
+    void Add(const void* p, size_t n)
+    {
+        auto c = static_cast<const unsigned char*>(p);
+        for (size_t i=0; i<n; i++)
+        {
+            _h ^= c[i];
+            _h *= 1099511628211ULL;
+        }
+    }
+    void Add(const std::string& s)
+    {
+        // Include the terminator so adjacent fields cannot run together.
+        Add(s.c_str(), s.size() + 1);
+    }
+    template<typename T>
+    void Add(T v)
+    {
+        int64_t n = static_cast<int64_t>(v);
+        Add(&n, sizeof(n));
+    }
+    uint64_t Value() const
+    {
+        return _h;
+    }
+
+private:
+    uint64_t _h = 14695981039346656037ULL;
+};
+}
+
+uint64_t Entry::ContentHash() const
 {
-    return 0;
+    Hasher h;
+    h.Add(_starttime);
+    h.Add(_endtime);
+    h.Add(_originalairdate);
+    h.Add(_season);
+    h.Add(_episode);
+    h.Add(_genre);
+    h.Add(_episodenumber.str());
+    h.Add(_episodetitle);
+    h.Add(_title.str());
+    h.Add(_synopsis);
+    h.Add(_imageURL.str());
+    h.Add(_posterURL.str());
+    h.Add(_seriesID.str());
+    return h.Value();
+}
+
+uint32_t Entry::PreferredID() const
+{
+    Hasher h;
+    h.Add(_starttime);
+    if (_seriesID.empty())
+    {
+        // Adding or removing a recording rule keeps the ID.
+        h.Add(_title.str().substr(_marked ? 2 : 0));
+    }
+    else
+    {
+        h.Add(_seriesID.str());
+    }
+    uint64_t v = h.Value();
+
+    // 31 bits, and never 0.
+    uint32_t id = static_cast<uint32_t>(v ^ (v >> 32)) & 0x7fffffff;
+    return id ? id : 1;
 }
 
 bool operator==(const Entry& a, const Entry& b)
@@ -95,4 +173,38 @@ bool operator<(const Entry& a, const Entry& b)
     return a._starttime < b._starttime;
 }
 
+void Entry::Save(SnapshotWriter& w) const
+{
+    w.PutTime(_starttime);
+    w.PutTime(_endtime);
+    w.PutTime(_originalairdate);
+    w.Put(static_cast<int32_t>(_season));
+    w.Put(static_cast<int32_t>(_episode));
+    w.Put(_episodenumber);
+    w.Put(_episodetitle);
+    w.Put(_title);
+    w.Put(_marked);
+    w.Put(_synopsis);
+    w.Put(_imageURL);
+    w.Put(_posterURL);
+    w.Put(_seriesID);
+    w.Put(_genre);
+}
+
+bool Entry::Load(SnapshotReader& r)
+{
+    int32_t season, episode;
+    if (!(r.GetTime(_starttime) && r.GetTime(_endtime) && r.GetTime(_originalairdate)
+            && r.Get(season) && r.Get(episode)
+            && r.Get(_episodenumber) && r.Get(_episodetitle)
+            && r.Get(_title) && r.Get(_marked) && r.Get(_synopsis)
+            && r.Get(_imageURL) && r.Get(_posterURL) && r.Get(_seriesID)
+            && r.Get(_genre)))
+        return false;
+
+    _season  = season;
+    _episode = episode;
+    return true;
+}
+
 }
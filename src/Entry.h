@@ -20,6 +20,8 @@
  *
  */
 
+#include "Snapshot.h"
+#include "StringPool.h"
 #include <string>
 #include <cstdint>
 #include <json/json.h>
@@ -32,26 +34,60 @@ class Entry
 {
 public:
     Entry(const Json::Value&);
-    virtual ~Entry() = default;
+    Entry() = default;
 
     time_t _starttime       = 0;
     time_t _endtime         = 0;
     time_t _originalairdate = 0;
     int         _season     = 0;
     int         _episode    = 0;
-    std::string _episodenumber;
-    std::string _episodetitle;
+    // Text which repeats across entries is pooled, per-episode text is not.
+    PooledString _episodenumber;
+    std::string  _episodetitle;
 
-    std::string _title;
-    std::string _synopsis;
-    std::string _imageURL;
-    std::string _posterURL;
-    std::string _seriesID;
-    uint32_t    _genre;
+    PooledString _title;
+    bool         _marked = false; // _title starts with the recording rule mark
+    std::string  _synopsis;
+    PooledString _imageURL;
+    PooledString _posterURL;
+    PooledString _seriesID;
+    uint32_t    _genre = 0;
 
-    virtual time_t StartTime() const;
-    virtual time_t EndTime() const;
-    virtual size_t Length() const;
+    time_t StartTime() const;
+    time_t EndTime() const;
+
+    // Hash of everything sent to Kodi, to detect changed entries.
+    uint64_t ContentHash() const;
+    // Derived from the start time and the programme, so a broadcast gets
+    // the same ID in every session.
+    uint32_t PreferredID() const;
+
+    void Save(SnapshotWriter&) const;
+    bool Load(SnapshotReader&);
+
+    // Sets _season and _episode from an "S01E02" episode number.
+    void ParseEpisodeNumber();
+    // The title as sent, marked if a recording rule matches.
+    void SetTitle(const std::string& title, bool recording);
+
+    static uint32_t GetGenreType(const std::string& filter)
+    {
+        if (filter == "News")
+            return EPG_EVENT_CONTENTMASK_NEWSCURRENTAFFAIRS;
+        else if (filter == "Comedy")
+            return EPG_EVENT_CONTENTMASK_SHOW;
+        else if (filter == "Movie" || filter == "Drama")
+            return EPG_EVENT_CONTENTMASK_MOVIEDRAMA;
+        else if (filter == "Food")
+            return EPG_EVENT_CONTENTMASK_LEISUREHOBBIES;
+        else if (filter == "Talk Show")
+            return EPG_EVENT_CONTENTMASK_SHOW;
+        else if (filter == "Game Show")
+            return EPG_EVENT_CONTENTMASK_SHOW;
+        else if (filter == "Sport" || filter == "Sports")
+            return EPG_EVENT_CONTENTMASK_SPORTS;
+        return 0;
+    }
 
     template<typename T>
     static uint32_t GetGenreType(const T& arr)
@@ -60,22 +96,7 @@ public:
 
         for (auto& i : arr)
         {
-            auto str = i.asString();
-
-            if (str == "News")
-                nGenreType |= EPG_EVENT_CONTENTMASK_NEWSCURRENTAFFAIRS;
-            else if (str == "Comedy")
-                nGenreType |= EPG_EVENT_CONTENTMASK_SHOW;
-            else if (str == "Movie" || str == "Drama")
-                nGenreType |= EPG_EVENT_CONTENTMASK_MOVIEDRAMA;
-            else if (str == "Food")
-                nGenreType |= EPG_EVENT_CONTENTMASK_LEISUREHOBBIES;
-            else if (str == "Talk Show")
-                nGenreType |= EPG_EVENT_CONTENTMASK_SHOW;
-            else if (str == "Game Show")
-                nGenreType |= EPG_EVENT_CONTENTMASK_SHOW;
-            else if (str == "Sport" || str == "Sports")
-                nGenreType |= EPG_EVENT_CONTENTMASK_SPORTS;
+            nGenreType |= GetGenreType(i.asString());
         }
 
         return nGenreType;
@@ -23,15 +23,21 @@
 #include "Addon.h"
 #include "Utils.h"
 
+#include <algorithm>
 #include <iostream>
 
 namespace PVRHDHomeRun
 {
 
 GuideNumber::GuideNumber(const Json::Value& v)
+    : GuideNumber(v["GuideNumber"].asString(), v["GuideName"].asString())
 {
-    _guidenumber = v["GuideNumber"].asString();
-    _guidename   = v["GuideName"].asString();
+}
+
+GuideNumber::GuideNumber(const std::string& guidenumber, const std::string& guidename)
+{
+    _guidenumber = guidenumber;
+    _guidename   = guidename;
 
      _channel = atoi(_guidenumber.c_str());
      auto dot = _guidenumber.find('.');
@@ -86,10 +92,6 @@ std::string GuideNumber::extendedName() const
             + "_guidename("   + _guidename   + ") ";
 }
 
-GuideEntry::GuideEntry(const Json::Value& v)
-: Entry(v)
-{
-}
 bool operator<(const GuideEntry& a, const GuideEntry& b)
 {
     return static_cast<const Entry&>(a) < static_cast<const Entry&>(b);
@@ -100,78 +102,428 @@ bool operator==(const GuideEntry& a, const GuideEntry& b)
             && a._id == b._id;
 }
 
-EPG_TAG GuideEntry::Epg_Tag(uint32_t number) const
+void GuideEntry::Save(SnapshotWriter& w) const
+{
+    Entry::Save(w);
+    w.Put(_id);
+}
+bool GuideEntry::Load(SnapshotReader& r)
+{
+    if (!(Entry::Load(r) && r.Get(_id)))
+        return false;
+    _hash = ContentHash();
+    return true;
+}
+
+void Guide::SetNames(const std::string& guidename, const std::string& affiliate, const std::string& imageURL)
+{
+    _guidename = guidename;
+    _affiliate = affiliate;
+    _imageURL  = imageURL;
+}
+
+Guide::~Guide()
+{
+    if (_coverage)
+        _coverage->Drop(_hours, _times);
+}
+
+size_t Guide::_lower_bound(time_t start) const
+{
+    return std::lower_bound(_slots.begin(), _slots.end(), start,
+            [](const Slot& s, time_t t) { return s.start < t; }) - _slots.begin();
+}
+
+Guide::Text Guide::_take_text(GuideEntry& v)
+{
+    Text t;
+    t.originalairdate = v._originalairdate;
+    t.season          = v._season;
+    t.episode         = v._episode;
+    t.episodenumber   = std::move(v._episodenumber);
+    t.episodetitle    = std::move(v._episodetitle);
+    t.title           = std::move(v._title);
+    t.marked          = v._marked;
+    t.synopsis        = std::move(v._synopsis);
+    t.imageURL        = std::move(v._imageURL);
+    t.posterURL       = std::move(v._posterURL);
+    t.seriesID        = std::move(v._seriesID);
+    t.hash            = v._hash;
+    return t;
+}
+
+uint32_t Guide::_store_text(GuideEntry& v)
+{
+    if (_text_free.empty())
+    {
+        _text.push_back(_take_text(v));
+        return static_cast<uint32_t>(_text.size() - 1);
+    }
+    auto i = _text_free.back();
+    _text_free.pop_back();
+    _text[i] = _take_text(v);
+    return i;
+}
+
+void Guide::_free_text(uint32_t i)
+{
+    _text[i] = Text();
+    _text_free.push_back(i);
+}
+
+GuideEntry Guide::_entry(const Slot& s) const
+{
+    auto& t = _text[s.text];
+
+    GuideEntry v;
+    v._starttime       = s.start;
+    v._endtime         = s.end;
+    v._id              = s.id;
+    v._genre           = s.genre;
+    v._originalairdate = t.originalairdate;
+    v._season          = t.season;
+    v._episode         = t.episode;
+    v._episodenumber   = t.episodenumber;
+    v._episodetitle    = t.episodetitle;
+    v._title           = t.title;
+    v._marked          = t.marked;
+    v._synopsis        = t.synopsis;
+    v._imageURL        = t.imageURL;
+    v._posterURL       = t.posterURL;
+    v._seriesID        = t.seriesID;
+    v._hash            = t.hash;
+    return v;
+}
+
+EPG_TAG Guide::_epg_tag(const Slot& s, uint32_t number) const
 {
+    auto& t = _text[s.text];
+
     EPG_TAG tag = {0};
 
     tag.iUniqueChannelId   = number;
 
-    tag.iUniqueBroadcastId = _id;
-    tag.strTitle           = _title.c_str();
-    tag.strEpisodeName     = _episodetitle.c_str();
-    tag.startTime          = _starttime;
-    tag.endTime            = _endtime;
-    tag.firstAired         = _originalairdate;
-    tag.strPlot            = _synopsis.c_str();
-    tag.strIconPath        = _imageURL.c_str();
-    tag.iGenreType         = _genre;
-    tag.iSeriesNumber      = _season;
-    tag.iEpisodeNumber     = _episode;
+    tag.iUniqueBroadcastId = s.id;
+    tag.strTitle           = t.title.c_str();
+    tag.strEpisodeName     = t.episodetitle.c_str();
+    tag.startTime          = s.start;
+    tag.endTime            = s.end;
+    tag.firstAired         = t.originalairdate;
+    tag.strPlot            = t.synopsis.c_str();
+    tag.strIconPath        = t.imageURL.c_str();
+    tag.iGenreType         = s.genre;
+    tag.iSeriesNumber      = t.season;
+    tag.iEpisodeNumber     = t.episode;
 
     return tag;
 }
 
-Guide::Guide(const Json::Value& v)
+void Guide::_cover(const Interval& i)
 {
-    _guidename = v["GuideName"].asString();
-    _affiliate = v["Affiliate"].asString();
-    _imageURL  = v["ImageURL"].asString();
+    if (_coverage)
+    {
+        for (auto& gap : _times.Gaps(i))
+        {
+            _coverage->Add(_hours, gap);
+        }
+    }
+    _times.Add(i);
 }
 
-bool Guide::AddEntry(GuideEntry& v, uint32_t number)
+void Guide::_uncover(const std::vector<Interval>& sorted)
 {
-    bool newentry = false;
-    auto it = _entries.find(v);
-    if (it == _entries.end())
-    {
-        v._id = _sequence.acquire();
-        newentry = true;
-    }
-    else
+    if (_coverage)
     {
-        v._id = it->_id;
+        for (auto& r : sorted)
+        {
+            for (auto& piece : _times.Overlap(r))
+            {
+                _coverage->Remove(_hours, piece);
+            }
+        }
     }
+    _times.Remove(sorted);
+}
+
+bool Guide::AddEntry(GuideEntry& v)
+{
+    // Would break the ordering of end times.
+    if (v._endtime < v._starttime)
+        return false;
 
     Interval i(v);
-    _times.Add(i);
+    _cover(i);
     _requests.Remove(i);
-    _entries.insert(v);
 
-    EPG_EVENT_STATE state = newentry ? EPG_EVENT_CREATED : EPG_EVENT_UPDATED;
-    EPG_TAG tag = v.Epg_Tag(number);
-    g.PVR->EpgEventStateChange(&tag, state);
+    auto pos = _lower_bound(v._starttime);
+    bool exists = pos < _slots.size() && _slots[pos].start == v._starttime;
+    if (exists && _text[_slots[pos].text].hash == v._hash)
+        return false;
+
+    pos = _evict_overlaps(v, pos);
+
+    if (!exists)
+    {
+        v._id = _broadcast_ids.acquire(v.PreferredID());
+        Slot s = {v._starttime, v._endtime, v._id, v._genre, 0};
+        s.text = _store_text(v);
+        _slots.insert(_slots.begin() + pos, s);
+        _pending[s.start] = EPG_EVENT_CREATED;
+        return true;
+    }
 
-    return newentry;
+    auto& s = _slots[pos];
+    if (s.end > v._endtime)
+        _uncover({{v._endtime, s.end}});
+    v._id   = s.id;
+    s.end   = v._endtime;
+    s.genre = v._genre;
+    _text[s.text] = _take_text(v);
+    // An entry created in this merge is still new to Kodi.
+    _pending.insert({s.start, EPG_EVENT_UPDATED});
+    return false;
 }
 
-void Guide::_age_out(uint32_t number, time_t limit)
+// Only the entry before v can reach into it, the rest of the overlapping
+// entries start within it.  Returns the new position of v.
+size_t Guide::_evict_overlaps(const GuideEntry& v, size_t pos)
+{
+    Interval kept(v);
+    std::vector<Interval> exposed;
+
+    size_t first = pos;
+    if (first < _slots.size() && _slots[first].start == v._starttime)
+        first ++;
+    size_t last = first;
+    while (last < _slots.size() && _slots[last].start < v._endtime)
+    {
+        _evict(last++, kept, exposed);
+    }
+    _slots.erase(_slots.begin() + first, _slots.begin() + last);
+
+    if (pos > 0 && _slots[pos-1].end > v._starttime)
+    {
+        pos --;
+        _evict(pos, kept, exposed);
+        _slots.erase(_slots.begin() + pos);
+    }
+
+    if (exposed.size())
+    {
+        std::sort(exposed.begin(), exposed.end());
+        _uncover(exposed);
+    }
+    return pos;
+}
+
+// Releases everything but the slot itself.  The parts of its time outside
+// kept, which no other entry covers, are added to exposed.
+void Guide::_evict(size_t i, const Interval& kept, std::vector<Interval>& exposed)
 {
-    auto it = _entries.begin();
-    while (it != _entries.end())
+    auto& s = _slots[i];
+
+    if (s.start < kept.Start())
+        exposed.push_back({s.start, std::min(s.end, kept.Start())});
+    if (s.end > kept.End())
+        exposed.push_back({std::max(s.start, kept.End()), s.end});
+
+    // Kodi has not been told about an entry created in this merge.
+    bool known = true;
+    auto p = _pending.find(s.start);
+    if (p != _pending.end())
+    {
+        known = p->second != EPG_EVENT_CREATED;
+        _pending.erase(p);
+    }
+    if (known)
+    {
+        _removed.push_back({s.id, s.start, s.end});
+    }
+
+    KODI_LOG(LOG_DEBUG, "Removing superseded guide entry %u %s", s.id, _text[s.text].title.c_str());
+    _broadcast_ids.release(s.id);
+    _free_text(s.text);
+}
+
+void Guide::Notify(uint32_t number)
+{
+    // Deletions first, their IDs may have been reused.
+    for (auto& r : _removed)
+    {
+        EPG_TAG tag = {0};
+        tag.iUniqueChannelId   = number;
+        tag.iUniqueBroadcastId = r.id;
+        tag.strTitle           = "";
+        tag.startTime          = r.starttime;
+        tag.endTime            = r.endtime;
+        g.PVR->EpgEventStateChange(&tag, EPG_EVENT_DELETED);
+    }
+    _removed.clear();
+
+    for (auto& p : _pending)
+    {
+        auto pos = _lower_bound(p.first);
+        if (pos == _slots.size() || _slots[pos].start != p.first)
+            continue;
+
+        EPG_TAG tag = _epg_tag(_slots[pos], number);
+        g.PVR->EpgEventStateChange(&tag, p.second);
+    }
+    _pending.clear();
+}
+
+void Guide::Save(SnapshotWriter& w) const
+{
+    w.Put(_guidename);
+    w.Put(_affiliate);
+    w.Put(_imageURL);
+    w.Put(static_cast<uint32_t>(_slots.size()));
+    for (auto& s : _slots)
     {
-        auto& entry = *it;
-        time_t end = entry._endtime;
-        if (end < limit)
+        _entry(s).Save(w);
+    }
+    _times.Save(w);
+    _requests.Save(w);
+    w.PutTime(_wanted);
+}
+
+// Entries keep their broadcast IDs, which Kodi already knows.
+bool Guide::Load(SnapshotReader& r)
+{
+    uint32_t count;
+    if (!(r.Get(_guidename) && r.Get(_affiliate) && r.Get(_imageURL) && r.Count(count)))
+        return false;
+
+    for (uint32_t n=0; n<count; n++)
+    {
+        GuideEntry entry;
+        if (!entry.Load(r))
+            return false;
+
+        // Saved in order, anything out of order or overlapping is dropped.
+        if (entry._endtime < entry._starttime
+                || (_slots.size() && _slots.back().end > entry._starttime))
+            continue;
+
+        _broadcast_ids.reserve(entry._id);
+        Slot s = {entry._starttime, entry._endtime, entry._id, entry._genre, 0};
+        s.text = _store_text(entry);
+        _slots.push_back(s);
+    }
+    IntervalSet times;
+    if (!(times.Load(r) && _requests.Load(r) && r.GetTime(_wanted)))
+        return false;
+
+    if (_coverage)
+    {
+        _coverage->Drop(_hours, _times);
+        for (auto& i : times.Intervals())
         {
-            _times.Remove(entry);
-            it = _entries.erase(it);
-            _sequence.release(entry._id);
+            _coverage->Add(_hours, i);
         }
-        else
-            it ++;
     }
+    _times = times;
+    return true;
+}
+
+// End times are sorted, so the stale entries are a prefix.
+void Guide::_age_out(uint32_t number, time_t limit)
+{
+    auto stale = std::lower_bound(_slots.begin(), _slots.end(), limit,
+            [](const Slot& s, time_t t) { return s.end < t; });
+    std::vector<Interval> removed;
+    removed.reserve(stale - _slots.begin());
+    for (auto it = _slots.begin(); it != stale; it++)
+    {
+        removed.push_back({it->start, it->end});
+        _broadcast_ids.release(it->id);
+        _free_text(it->text);
+    }
+    _slots.erase(_slots.begin(), stale);
+    _uncover(removed);
     _requests.Remove({0, limit});
 }
 
 
+size_t GuideTable::_lower_bound(uint32_t id) const
+{
+    return std::lower_bound(_ids.begin(), _ids.end(), id) - _ids.begin();
+}
+
+Guide* GuideTable::Find(uint32_t id)
+{
+    auto i = _lower_bound(id);
+    if (i == _ids.size() || _ids[i] != id)
+        return nullptr;
+    return _guides[i].get();
+}
+
+const Guide* GuideTable::Find(uint32_t id) const
+{
+    auto i = _lower_bound(id);
+    if (i == _ids.size() || _ids[i] != id)
+        return nullptr;
+    return _guides[i].get();
+}
+
+Guide& GuideTable::Insert(uint32_t id)
+{
+    auto i = _lower_bound(id);
+    if (i == _ids.size() || _ids[i] != id)
+    {
+        _ids.insert(_ids.begin() + i, id);
+        _guides.insert(_guides.begin() + i, std::unique_ptr<Guide>(new Guide(&_coverage)));
+    }
+    return *_guides[i];
+}
+
+void GuideTable::Erase(uint32_t id)
+{
+    auto i = _lower_bound(id);
+    if (i == _ids.size() || _ids[i] != id)
+        return;
+    _ids.erase(_ids.begin() + i);
+    _guides.erase(_guides.begin() + i);
+}
+
+void GuideTable::Clear()
+{
+    _ids.clear();
+    _guides.clear();
+    _expiry = decltype(_expiry)();
+}
+
+void GuideTable::QueueAgeOut(uint32_t id)
+{
+    auto guide = Find(id);
+    if (!guide || !guide->Size())
+        return;
+
+    // An element no later than this one is already queued.
+    time_t end = guide->FirstEnd();
+    if (guide->_queued && guide->_queued <= end)
+        return;
+
+    guide->_queued = end;
+    _expiry.push({end, id});
+}
+
+void GuideTable::AgeOut(time_t limit)
+{
+    while (_expiry.size() && _expiry.top().first < limit)
+    {
+        auto e = _expiry.top();
+        _expiry.pop();
+
+        // Erased, or queued again since
+        auto guide = Find(e.second);
+        if (!guide || guide->_queued != e.first)
+            continue;
+
+        guide->_queued = 0;
+        guide->_age_out(e.second, limit);
+        QueueAgeOut(e.second);
+    }
+}
+
 } // namespace PVRHDHomeRUn
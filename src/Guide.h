@@ -23,8 +23,15 @@
 #include "IntervalSet.h"
 #include "Addon.h"
 #include "Entry.h"
+#include "GuideCoverage.h"
 #include "UniqueID.h"
 #include <json/json.h>
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <memory>
+#include <queue>
+#include <vector>
 
 namespace PVRHDHomeRun
 {
@@ -35,6 +42,7 @@ private:
     static const uint32_t SubchannelLimit = 100000;
 public:
     GuideNumber(const Json::Value&);
+    GuideNumber(const std::string& guidenumber, const std::string& guidename);
     GuideNumber(const GuideNumber&) = default;
     GuideNumber(uint32_t id)
     {
@@ -70,11 +78,16 @@ class GuideEntry : public Entry
 {
 private:
     uint32_t _id;
+    uint64_t _hash = 0;
     friend class Guide;
+    friend class GuideParser;
     friend bool operator<(const GuideEntry&, const GuideEntry&);
     friend bool operator==(const GuideEntry&, const GuideEntry&);
 public:
-    GuideEntry(const Json::Value&);
+    GuideEntry() = default;
+
+    void Save(SnapshotWriter&) const;
+    bool Load(SnapshotReader&);
 
 
 public:
@@ -82,7 +95,6 @@ public:
     {
         return {_starttime, _endtime};
     }
-    EPG_TAG Epg_Tag(uint32_t number) const;
 };
 
 bool operator<(const GuideEntry&, const GuideEntry&);
@@ -91,10 +103,22 @@ bool operator==(const GuideEntry&, const GuideEntry&);
 class Guide
 {
 public:
-    Guide(const Json::Value&);
-    Guide() = default;
+    // The coverage index, if any, follows _times.
+    Guide(GuideCoverage* coverage = nullptr)
+        : _coverage(coverage)
+    {}
+    Guide(const Guide&) = delete;
+    Guide& operator=(const Guide&) = delete;
+    ~Guide();
+
+    void SetNames(const std::string& guidename, const std::string& affiliate, const std::string& imageURL);
 
-    bool AddEntry(GuideEntry&, uint32_t number);
+    // Queues a notification if the entry is new or its content changed.
+    // Entries it overlaps, other than the one it replaces, are removed.
+    // Returns true if the entry is new.
+    bool AddEntry(GuideEntry&);
+    // Sends the queued notifications, once per merge.
+    void Notify(uint32_t number);
     void AddRequest(const Interval& r)
     {
         _requests.Add(r);
@@ -105,6 +129,16 @@ public:
     }
     void _age_out(uint32_t number, time_t limit);
 
+    // The latest time Kodi has asked this channel's guide for.
+    void Want(time_t end)
+    {
+        _wanted = std::max(_wanted, end);
+    }
+    time_t Wanted() const
+    {
+        return _wanted;
+    }
+
     const IntervalSet& Times() const
     {
         return _times;
@@ -125,21 +159,159 @@ public:
     {
         return _imageURL;
     }
-    const std::set<GuideEntry>& Entries() const
+    size_t Size() const
+    {
+        return _slots.size();
+    }
+    // The earliest entry ends first.
+    time_t FirstEnd() const
     {
-        return _entries;
+        return _slots.front().end;
     }
 
+    // Calls f with the tag of each entry overlapping [start, end], in start
+    // order, in O(log n + k).  Only the slots are searched.
+    template<typename F>
+    void ForEachInWindow(time_t start, time_t end, uint32_t number, F f) const
+    {
+        auto it = std::lower_bound(_slots.begin(), _slots.end(), start,
+                [](const Slot& s, time_t t) { return s.end < t; });
+        for (; it != _slots.end() && it->start <= end; it++)
+        {
+            EPG_TAG tag = _epg_tag(*it, number);
+            f(tag);
+        }
+    }
+
+    void Save(SnapshotWriter&) const;
+    bool Load(SnapshotReader&);
+
 private:
+    // The data scanned by time-range queries, sorted by start time.  Entries
+    // are kept disjoint, so the end times are sorted as well.  The rest of
+    // the entry is in _text[text].
+    struct Slot
+    {
+        time_t   start;
+        time_t   end;
+        uint32_t id;
+        uint32_t genre;
+        uint32_t text;
+    };
+    // The fields of an entry which are not in its slot, read only for the
+    // entries a query returns.
+    struct Text
+    {
+        time_t       originalairdate = 0;
+        int          season  = 0;
+        int          episode = 0;
+        PooledString episodenumber;
+        std::string  episodetitle;
+        PooledString title;
+        bool         marked = false;
+        std::string  synopsis;
+        PooledString imageURL;
+        PooledString posterURL;
+        PooledString seriesID;
+        uint64_t     hash = 0;
+    };
+
+    size_t   _lower_bound(time_t start) const;
+    size_t   _evict_overlaps(const GuideEntry&, size_t pos);
+    void     _evict(size_t i, const Interval& kept, std::vector<Interval>& exposed);
+    static Text _take_text(GuideEntry&);
+    uint32_t _store_text(GuideEntry&);
+    void     _free_text(uint32_t);
+    GuideEntry _entry(const Slot&) const;
+    EPG_TAG    _epg_tag(const Slot&, uint32_t number) const;
+    void     _cover(const Interval&);
+    void     _uncover(const std::vector<Interval>& sorted);
+
+    struct Removed
+    {
+        uint32_t id;
+        time_t   starttime;
+        time_t   endtime;
+    };
+
     std::string          _guidename;
     std::string          _affiliate;
     std::string          _imageURL;
-    std::set<GuideEntry> _entries;
-    UniqueID<uint32_t>   _sequence;
+    std::vector<Slot>       _slots;
+    std::vector<Text>       _text;
+    std::vector<uint32_t>   _text_free;
+    UniqueID<uint32_t>   _broadcast_ids;
+    std::map<time_t, EPG_EVENT_STATE> _pending; // by start time
+    std::vector<Removed> _removed;
 
     IntervalSet          _times;
     IntervalSet          _requests;
+    time_t               _wanted = 0;
+    GuideCoverage*       _coverage;
+    GuideCoverage::Channel _hours;
+    time_t               _queued = 0; // In the age-out queue, 0 if not
+    friend class GuideTable;
 };
 
 
+// Guides by channel ID, sorted for binary search.  Each guide is allocated
+// separately so references remain valid while others are added.
+class GuideTable
+{
+public:
+    GuideTable() = default;
+    GuideTable(const GuideTable&) = delete;
+    GuideTable& operator=(const GuideTable&) = delete;
+
+    size_t Size() const
+    {
+        return _ids.size();
+    }
+    uint32_t ID(size_t i) const
+    {
+        return _ids[i];
+    }
+    Guide& At(size_t i)
+    {
+        return *_guides[i];
+    }
+    const Guide& At(size_t i) const
+    {
+        return *_guides[i];
+    }
+    std::vector<uint32_t> IDs() const
+    {
+        return _ids;
+    }
+    const GuideCoverage& Coverage() const
+    {
+        return _coverage;
+    }
+
+    Guide*       Find(uint32_t id);
+    const Guide* Find(uint32_t id) const;
+    // The existing guide for the channel, or a new one.
+    Guide&       Insert(uint32_t id);
+    void         Erase(uint32_t id);
+    void         Clear();
+
+    // To be called whenever entries have been added to a guide.
+    void QueueAgeOut(uint32_t id);
+    // Ages out only the guides whose first entry has ended.
+    void AgeOut(time_t limit);
+
+private:
+    size_t _lower_bound(uint32_t id) const;
+
+    // Outlives the guides, which update it as they go.
+    GuideCoverage                       _coverage;
+    std::vector<uint32_t>               _ids;
+    std::vector<std::unique_ptr<Guide>> _guides;
+
+    // Guides by the end of their first entry, earliest first.  A guide is
+    // queued again when that moves earlier, the later element is skipped.
+    typedef std::pair<time_t, uint32_t> Expiry;
+    std::priority_queue<Expiry, std::vector<Expiry>, std::greater<Expiry>> _expiry;
+};
+
 } // namespace PVRHDHomeRun
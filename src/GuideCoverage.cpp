@@ -0,0 +1,139 @@
+/*
+ *      Copyright (C) 2017-2019 Matthew Lundberg <matthew.k.lundberg@gmail.com>
+ *      https://github.com/MatthewLundberg/pvr.hdhomerun
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include "GuideCoverage.h"
+
+#include <algorithm>
+#include <iterator>
+
+namespace PVRHDHomeRun
+{
+
+void GuideCoverage::_change(Channel& channel, time_t bucket, int64_t seconds)
+{
+    if (channel.empty())
+        _channels ++;
+
+    auto& covered = channel[bucket];
+    auto& counts  = _hours[bucket];
+
+    uint32_t before = covered;
+    covered = static_cast<uint32_t>(before + seconds);
+
+    if (before == 0)
+        counts.partial ++;
+    if (before == Bucket)
+        counts.full --;
+    if (covered == Bucket)
+        counts.full ++;
+    if (covered == 0)
+    {
+        counts.partial --;
+        channel.erase(bucket);
+        if (counts.partial == 0)
+            _hours.erase(bucket);
+        if (channel.empty())
+            _channels --;
+    }
+}
+
+GuideCoverage::Depth::iterator GuideCoverage::_split(time_t t)
+{
+    auto it = _depth.lower_bound(t);
+    if (it != _depth.end() && it->first == t)
+        return it;
+    uint32_t depth = it == _depth.begin() ? 0 : std::prev(it)->second;
+    return _depth.insert(it, {t, depth});
+}
+
+// Erases the start of a stretch which no longer differs from the one before.
+void GuideCoverage::_merge(Depth::iterator it)
+{
+    uint32_t before = it == _depth.begin() ? 0 : std::prev(it)->second;
+    if (it->second == before)
+        _depth.erase(it);
+}
+
+void GuideCoverage::_depth_change(const Interval& i, int delta)
+{
+    if (i.Start() >= i.End())
+        return;
+
+    auto end   = _split(i.End());
+    auto start = _split(i.Start());
+    for (auto it = start; it != end; it++)
+    {
+        it->second += delta;
+    }
+    // Only the stretches at either end can now equal their neighbour.
+    _merge(end);
+    _merge(start);
+}
+
+void GuideCoverage::Add(Channel& channel, const Interval& i)
+{
+    _depth_change(i, 1);
+    for (time_t b = _bucket(i.Start()); b < i.End(); b += Bucket)
+    {
+        time_t seconds = std::min(i.End(), b + Bucket) - std::max(i.Start(), b);
+        if (seconds > 0)
+            _change(channel, b, seconds);
+    }
+}
+
+void GuideCoverage::Remove(Channel& channel, const Interval& i)
+{
+    _depth_change(i, -1);
+    for (time_t b = _bucket(i.Start()); b < i.End(); b += Bucket)
+    {
+        time_t seconds = std::min(i.End(), b + Bucket) - std::max(i.Start(), b);
+        if (seconds > 0)
+            _change(channel, b, -seconds);
+    }
+}
+
+void GuideCoverage::Drop(Channel& channel, const IntervalSet& times)
+{
+    for (const auto& i : times.Intervals())
+    {
+        Remove(channel, i);
+    }
+}
+
+bool GuideCoverage::Covered(time_t t) const
+{
+    auto it = _depth.upper_bound(t);
+    return it != _depth.begin() && std::prev(it)->second > 0;
+}
+
+time_t GuideCoverage::EarliestGap(time_t from, time_t to) const
+{
+    auto it = _hours.find(_bucket(from));
+    for (time_t b = _bucket(from); b < to; b += Bucket, it++)
+    {
+        // A missing hour is covered by none.
+        if (it == _hours.end() || it->first != b || it->second.full < _channels)
+            return std::max(b, from);
+    }
+    return to;
+}
+
+} // namespace PVRHDHomeRun
@@ -0,0 +1,90 @@
+#pragma once
+/*
+ *      Copyright (C) 2017-2019 Matthew Lundberg <matthew.k.lundberg@gmail.com>
+ *      https://github.com/MatthewLundberg/pvr.hdhomerun
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include "IntervalSet.h"
+#include <cstdint>
+#include <ctime>
+#include <map>
+
+namespace PVRHDHomeRun
+{
+
+// The guide coverage of all channels, counted by hour, so the questions
+// asked on every guide update do not visit each channel.
+//
+// Each channel keeps the seconds it covers of each hour.  An hour counts
+// the channels covering any of it, and those covering all of it.  Apart
+// from the hours, the channels covering each stretch of time are counted,
+// down to the second.
+//
+// Not locked, PVR_HDHR holds _guide_lock.
+class GuideCoverage
+{
+public:
+    static const time_t Bucket = 3600;
+
+    // Seconds covered by one channel, by hour
+    typedef std::map<time_t, uint32_t> Channel;
+
+    // The interval must be newly covered, or still covered, by the channel.
+    void Add(Channel&, const Interval&);
+    void Remove(Channel&, const Interval&);
+    // Removes everything the channel covers, which is 'times'.
+    void Drop(Channel&, const IntervalSet& times);
+
+    // Channels covering anything
+    size_t Channels() const
+    {
+        return _channels;
+    }
+    // True if any channel covers t
+    bool Covered(time_t t) const;
+    // The start of the first hour, from the one containing 'from' and
+    // before 'to', which some channel does not cover in full, or 'to'.
+    time_t EarliestGap(time_t from, time_t to) const;
+
+private:
+    struct Counts
+    {
+        uint32_t partial;
+        uint32_t full;
+    };
+
+    static time_t _bucket(time_t t)
+    {
+        return t - t % Bucket;
+    }
+    void _change(Channel&, time_t bucket, int64_t seconds);
+
+    typedef std::map<time_t, uint32_t> Depth;
+    Depth::iterator _split(time_t t);
+    void _merge(Depth::iterator);
+    void _depth_change(const Interval&, int delta);
+
+    std::map<time_t, Counts> _hours;
+    // Channels covering each stretch, by its start.  A stretch lasts until
+    // the next one, adjacent stretches differ, and the last covers none.
+    Depth                    _depth;
+    size_t                   _channels = 0;
+};
+
+} // namespace PVRHDHomeRun
@@ -0,0 +1,412 @@
+/*
+ *      Copyright (C) 2017-2019 Matthew Lundberg <matthew.k.lundberg@gmail.com>
+ *      https://github.com/MatthewLundberg/pvr.hdhomerun
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include "GuideParser.h"
+
+#include <cstdlib>
+#include <cstring>
+
+namespace PVRHDHomeRun
+{
+
+namespace
+{
+bool is_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+bool is_delimiter(char c)
+{
+    return is_space(c) || strchr(",:[]{}\"", c);
+}
+
+int hex_digit(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
+
+void append_utf8(std::string& s, uint32_t cp)
+{
+    if (cp < 0x80)
+    {
+        s.push_back(static_cast<char>(cp));
+    }
+    else if (cp < 0x800)
+    {
+        s.push_back(static_cast<char>(0xC0 | (cp >> 6)));
+        s.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    }
+    else if (cp < 0x10000)
+    {
+        s.push_back(static_cast<char>(0xE0 | (cp >> 12)));
+        s.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+        s.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    }
+    else
+    {
+        s.push_back(static_cast<char>(0xF0 | (cp >> 18)));
+        s.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3F)));
+        s.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+        s.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    }
+}
+}
+
+bool GuideParser::Feed(const char* data, size_t size)
+{
+    if (_failed)
+        return false;
+
+    for (size_t i=0; i<size; i++)
+    {
+        if (!_char(data[i]))
+            return false;
+    }
+    return true;
+}
+
+bool GuideParser::Finish()
+{
+    if (_failed)
+        return false;
+    if (_state == LITERAL)
+    {
+        _state = VALUE;
+        if (!_literal_end())
+            return false;
+    }
+    if (_state != VALUE || !_done)
+    {
+        _incomplete = true;
+        return _fail("Incomplete JSON guide data");
+    }
+    return true;
+}
+
+bool GuideParser::_fail(const char* error)
+{
+    _error  = error;
+    _failed = true;
+    return false;
+}
+
+bool GuideParser::_char(char c)
+{
+    switch (_state)
+    {
+    case STRING:
+        if (c == '"')
+        {
+            _state = VALUE;
+            return _string_end();
+        }
+        if (c == '\\')
+            _state = ESCAPE;
+        else
+            _token.push_back(c);
+        return true;
+
+    case ESCAPE:
+        _state = STRING;
+        switch (c)
+        {
+        case '"':
+        case '\\':
+        case '/': _token.push_back(c);    break;
+        case 'b': _token.push_back('\b'); break;
+        case 'f': _token.push_back('\f'); break;
+        case 'n': _token.push_back('\n'); break;
+        case 'r': _token.push_back('\r'); break;
+        case 't': _token.push_back('\t'); break;
+        case 'u':
+            _state          = UNICODE;
+            _unicode        = 0;
+            _unicode_digits = 0;
+            break;
+        default:
+            return _fail("Bad escape in JSON guide data");
+        }
+        return true;
+
+    case UNICODE:
+    {
+        int d = hex_digit(c);
+        if (d < 0)
+            return _fail("Bad escape in JSON guide data");
+        _unicode = (_unicode << 4) | d;
+        if (++_unicode_digits == 4)
+        {
+            _state = STRING;
+            _unicode_end();
+        }
+        return true;
+    }
+
+    case LITERAL:
+        if (!is_delimiter(c))
+        {
+            _token.push_back(c);
+            return true;
+        }
+        _state = VALUE;
+        if (!_literal_end())
+            return false;
+        // The delimiter is handled as usual.
+        break;
+
+    case VALUE:
+        break;
+    }
+
+    if (is_space(c))
+        return true;
+    if (_done)
+        return _fail("Trailing data after JSON guide data");
+    if (c == '"')
+    {
+        _token.clear();
+        _state = STRING;
+        return true;
+    }
+    if (strchr(",:[]{}", c))
+        return _structural(c);
+
+    _token.assign(1, c);
+    _state = LITERAL;
+    return true;
+}
+
+void GuideParser::_unicode_end()
+{
+    uint32_t cp = _unicode;
+    if (cp >= 0xD800 && cp < 0xDC00)
+    {
+        _surrogate = cp;
+        return;
+    }
+    if (cp >= 0xDC00 && cp < 0xE000)
+    {
+        if (!_surrogate)
+            return;
+        cp = 0x10000 + ((_surrogate - 0xD800) << 10) + (cp - 0xDC00);
+    }
+    _surrogate = 0;
+    append_utf8(_token, cp);
+}
+
+bool GuideParser::_structural(char c)
+{
+    switch (c)
+    {
+    case '{': return _begin(true);
+    case '[': return _begin(false);
+    case '}': return _end(true);
+    case ']': return _end(false);
+    }
+
+    if (_stack.empty())
+        return _fail("Unexpected separator in JSON guide data");
+    _expect_key = (c == ',') && _stack.back().object;
+    return true;
+}
+
+bool GuideParser::_begin(bool object)
+{
+    Role role = SKIP;
+    if (_stack.empty())
+    {
+        if (object)
+            return _fail("Top-level JSON guide data is not an array");
+        role = CHANNELS;
+    }
+    else
+    {
+        switch (_stack.back().role)
+        {
+        case CHANNELS:
+            if (object)
+            {
+                role = CHANNEL;
+                _channels.emplace_back();
+                _guidenumber.clear();
+                _guidename.clear();
+            }
+            break;
+        case CHANNEL:
+            if (!object && _key == "Guide")
+                role = ENTRIES;
+            break;
+        case ENTRIES:
+            if (object)
+            {
+                role = ENTRY;
+                _channels.back().entries.emplace_back();
+                _title.clear();
+                _recording = false;
+            }
+            break;
+        case ENTRY:
+            if (!object && _key == "Filter")
+                role = FILTER;
+            break;
+        default:
+            break;
+        }
+    }
+
+    _stack.push_back({role, object});
+    _expect_key = object;
+    return true;
+}
+
+bool GuideParser::_end(bool object)
+{
+    if (_stack.empty() || _stack.back().object != object)
+        return _fail("Mismatched brackets in JSON guide data");
+
+    auto role = _stack.back().role;
+    _stack.pop_back();
+    if (role == ENTRY)
+        _entry_end();
+    else if (role == CHANNEL)
+        _channel_end();
+
+    _expect_key = false;
+    _done = _stack.empty();
+    return true;
+}
+
+bool GuideParser::_string_end()
+{
+    if (!_stack.empty() && _stack.back().object && _expect_key)
+    {
+        _key.swap(_token);
+        return true;
+    }
+    return _scalar(_token, true);
+}
+
+bool GuideParser::_literal_end()
+{
+    const auto& t = _token;
+    bool number = t.size() && strchr("-0123456789", t[0])
+            && t.find_first_not_of("+-0123456789.eE") == std::string::npos;
+    if (!number && t != "true" && t != "false" && t != "null")
+        return _fail("Bad literal in JSON guide data");
+    return _scalar(t, false);
+}
+
+bool GuideParser::_scalar(const std::string& value, bool string)
+{
+    static const std::string empty;
+
+    if (_stack.empty())
+    {
+        // guide.php returns null when there is no guide.
+        if (!string && value == "null")
+        {
+            _done = true;
+            return true;
+        }
+        return _fail("Top-level JSON guide data is not an array");
+    }
+
+    // As Json::Value::asString()
+    const auto& v = (!string && value == "null") ? empty : value;
+    switch (_stack.back().role)
+    {
+    case CHANNEL:
+        _channel_field(v);
+        break;
+    case ENTRY:
+        _entry_field(v, string);
+        break;
+    case FILTER:
+        _channels.back().entries.back()._genre |= Entry::GetGenreType(v);
+        break;
+    default:
+        break;
+    }
+    return true;
+}
+
+void GuideParser::_channel_field(const std::string& value)
+{
+    auto& channel = _channels.back();
+    if (_key == "GuideNumber")
+        _guidenumber = value;
+    else if (_key == "GuideName")
+        _guidename = value;
+    else if (_key == "Affiliate")
+        channel.affiliate = value;
+    else if (_key == "ImageURL")
+        channel.imageURL = value;
+}
+
+void GuideParser::_entry_field(const std::string& value, bool string)
+{
+    auto& entry = _channels.back().entries.back();
+    if (_key == "StartTime")
+        entry._starttime = strtoll(value.c_str(), nullptr, 10);
+    else if (_key == "EndTime")
+        entry._endtime = strtoll(value.c_str(), nullptr, 10);
+    else if (_key == "OriginalAirdate")
+        entry._originalairdate = strtoll(value.c_str(), nullptr, 10);
+    else if (_key == "EpisodeNumber")
+        entry._episodenumber = value;
+    else if (_key == "EpisodeTitle")
+        entry._episodetitle = value;
+    else if (_key == "Synopsis")
+        entry._synopsis = value;
+    else if (_key == "ImageURL")
+        entry._imageURL = value;
+    else if (_key == "PosterURL")
+        entry._posterURL = value;
+    else if (_key == "SeriesID")
+        entry._seriesID = value;
+    else if (_key == "Title")
+        _title = value;
+    else if (_key == "RecordingRule")
+        _recording = !string && (value == "true" || atoi(value.c_str()) != 0);
+}
+
+// As the GuideEntry constructor
+void GuideParser::_entry_end()
+{
+    auto& entry = _channels.back().entries.back();
+    entry.SetTitle(_title, _recording);
+    entry.ParseEpisodeNumber();
+    entry._hash = entry.ContentHash();
+}
+
+void GuideParser::_channel_end()
+{
+    _channels.back().number = GuideNumber(_guidenumber, _guidename);
+}
+
+} // namespace PVRHDHomeRun
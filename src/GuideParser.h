@@ -0,0 +1,134 @@
+#pragma once
+/*
+ *      Copyright (C) 2017-2019 Matthew Lundberg <matthew.k.lundberg@gmail.com>
+ *      https://github.com/MatthewLundberg/pvr.hdhomerun
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+
+#include "Guide.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace PVRHDHomeRun
+{
+
+// Builds guide objects from a guide.php response as it is read, without a
+// copy of the whole response or a Json::Value DOM.  Only the fields used by
+// GuideNumber, Guide and GuideEntry are kept, anything else is skipped.
+class GuideParser
+{
+public:
+    struct Channel
+    {
+        Channel()
+            : number(0)
+        {}
+
+        GuideNumber             number;
+        std::string             affiliate;
+        std::string             imageURL;
+        std::vector<GuideEntry> entries;
+    };
+
+    // Returns false, and ignores further data, on malformed JSON.
+    bool Feed(const char* data, size_t size);
+    // Returns false unless a complete document was fed.  A "null" document
+    // is complete, with no channels.
+    bool Finish();
+
+    std::vector<Channel>& Channels()
+    {
+        return _channels;
+    }
+    const std::string& Error() const
+    {
+        return _error;
+    }
+    // The data was well formed up to where it stopped, as when a
+    // connection is dropped.
+    bool Incomplete() const
+    {
+        return _incomplete;
+    }
+
+private:
+    enum State
+    {
+        VALUE,
+        STRING,
+        ESCAPE,
+        UNICODE,
+        LITERAL,
+    };
+    // What a container holds, from where it appears in the document.
+    enum Role
+    {
+        SKIP,
+        CHANNELS,
+        CHANNEL,
+        ENTRIES,
+        ENTRY,
+        FILTER,
+    };
+    struct Container
+    {
+        Role role;
+        bool object;
+    };
+
+    bool _char(char c);
+    bool _structural(char c);
+    bool _string_end();
+    bool _literal_end();
+    void _unicode_end();
+    bool _begin(bool object);
+    bool _end(bool object);
+    bool _scalar(const std::string& value, bool string);
+    bool _fail(const char* error);
+
+    void _channel_field(const std::string& value);
+    void _entry_field(const std::string& value, bool string);
+    void _entry_end();
+    void _channel_end();
+
+    State       _state = VALUE;
+    std::string _token;
+    uint32_t    _unicode = 0;
+    int         _unicode_digits = 0;
+    uint32_t    _surrogate = 0;
+    bool        _expect_key = false;
+    bool        _done = false;
+    bool        _failed = false;
+    bool        _incomplete = false;
+
+    std::vector<Container> _stack;
+    std::string _key;
+    std::string _error;
+
+    // The channel and entry being built
+    std::string _guidenumber;
+    std::string _guidename;
+    std::string _title;
+    bool        _recording = false;
+
+    std::vector<Channel> _channels;
+};
+
+} // namespace PVRHDHomeRun
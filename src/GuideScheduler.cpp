@@ -0,0 +1,204 @@
+/*
+ *      Copyright (C) 2017-2019 Matthew Lundberg <matthew.k.lundberg@gmail.com>
+ *      https://github.com/MatthewLundberg/pvr.hdhomerun
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include "GuideScheduler.h"
+#include "Addon.h"
+
+#include <algorithm>
+
+namespace PVRHDHomeRun
+{
+
+int GuideScheduler::_random()
+{
+    std::uniform_int_distribution<int> distribution(0, g.Settings.guideRandom);
+    return distribution(_generator);
+}
+
+bool GuideScheduler::BasicDue(time_t now, bool covered)
+{
+    if (covered && now < _next_basic)
+        return false;
+
+    time_t interval = g.Settings.guideBasicInterval;
+    _next_basic = (now / interval + 1) * interval - g.Settings.guideBasicBeforeHour - _random();
+    if (_next_basic <= now)
+        _next_basic += interval;
+    return true;
+}
+
+void GuideScheduler::Begin()
+{
+    _queue = decltype(_queue)();
+    for (auto& s : _stagger)
+    {
+        s.second.seen = false;
+    }
+    _prune = true;
+}
+
+void GuideScheduler::Add(uint32_t number, const IntervalSet& requests, time_t now)
+{
+    time_t each       = g.Settings.guideExtendedEach;
+    time_t hysteresis = g.Settings.guideExtendedHysteresis;
+
+    // Only what is still requested remains in demand.
+    IntervalSet demand;
+    auto d = _demand.find(number);
+    if (d != _demand.end())
+    {
+        for (const auto& i : requests.Intervals())
+        {
+            for (const auto& piece : d->second.Overlap(i))
+            {
+                demand.Add(piece);
+            }
+        }
+        if (demand.Empty())
+            _demand.erase(d);
+        else
+            d->second = demand;
+    }
+
+    for (const auto& i : requests.Intervals())
+    {
+        // A short gap far ahead, such as the end of the guide moving with
+        // the clock, waits until it grows or comes near.
+        if (i.Length() < hysteresis && i.Start() > now + hysteresis)
+            continue;
+
+        for (time_t start = i.Start(); start < i.End(); start += each)
+        {
+            auto it = _stagger.find({number, start});
+            if (it == _stagger.end())
+            {
+                it = _stagger.insert({{number, start}, {now + _random(), false}}).first;
+            }
+            it->second.seen = true;
+
+            if (_inflight.count({number, start}))
+                continue;
+
+            time_t length = std::min(each, i.End() - start);
+            bool   urgent = !demand.Overlap({start, start + length}).empty();
+            _queue.push({number, start, length, urgent});
+        }
+    }
+}
+
+std::vector<GuideScheduler::Job> GuideScheduler::Dispatch(time_t now, size_t max)
+{
+    // Forget the stagger of gaps which have been filled, once per pass.
+    for (auto it = _stagger.begin(); _prune && it != _stagger.end(); )
+    {
+        if (it->second.seen)
+            it ++;
+        else
+            it = _stagger.erase(it);
+    }
+    _prune = false;
+
+    std::vector<Job> jobs;
+    std::vector<Job> waiting;
+    while (jobs.size() < max && !_queue.empty())
+    {
+        auto job = _queue.top();
+        _queue.pop();
+
+        // Dispatched for demand since the pass.
+        if (_inflight.count({job.number, job.start}))
+            continue;
+
+        if (job.urgent || _stagger[{job.number, job.start}].ready <= now)
+        {
+            _start(job);
+            jobs.push_back(job);
+        }
+        else
+        {
+            waiting.push_back(job);
+        }
+    }
+    for (const auto& job : waiting)
+    {
+        _queue.push(job);
+    }
+    return jobs;
+}
+
+void GuideScheduler::Demand(uint32_t number, const Interval& i)
+{
+    _demand[number].Add(i);
+}
+
+std::vector<GuideScheduler::Job> GuideScheduler::DispatchDemand(size_t max)
+{
+    time_t each = g.Settings.guideExtendedEach;
+
+    std::vector<Job> jobs;
+    for (const auto& d : _demand)
+    {
+        for (const auto& i : d.second.Intervals())
+        {
+            for (time_t start = i.Start(); start < i.End(); start += each)
+            {
+                jobs.push_back({d.first, start, std::min(each, i.End() - start), true});
+            }
+        }
+    }
+
+    std::sort(jobs.begin(), jobs.end(),
+            [](const Job& a, const Job& b) { return a.start < b.start; });
+
+    std::vector<Job> dispatched;
+    for (const auto& job : jobs)
+    {
+        if (dispatched.size() == max)
+            break;
+        // Already being fetched, asked for again is not a new job.
+        bool inflight = _inflight.count({job.number, job.start}) > 0;
+        _start(job);
+        if (!inflight)
+            dispatched.push_back(job);
+    }
+    return dispatched;
+}
+
+// Demand is met once a job for it is dispatched, a job which fails is
+// left to the regular passes.
+void GuideScheduler::_start(const Job& job)
+{
+    _inflight.insert({job.number, job.start});
+
+    auto d = _demand.find(job.number);
+    if (d == _demand.end())
+        return;
+    d->second.Remove({job.start, job.start + job.length});
+    if (d->second.Empty())
+        _demand.erase(d);
+}
+
+void GuideScheduler::Done(uint32_t number, time_t start)
+{
+    _inflight.erase({number, start});
+}
+
+} // namespace PVRHDHomeRun
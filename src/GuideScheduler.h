@@ -0,0 +1,112 @@
+#pragma once
+/*
+ *      Copyright (C) 2017-2019 Matthew Lundberg <matthew.k.lundberg@gmail.com>
+ *      https://github.com/MatthewLundberg/pvr.hdhomerun
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+
+#include "IntervalSet.h"
+#include <cstdint>
+#include <ctime>
+#include <map>
+#include <queue>
+#include <random>
+#include <set>
+#include <utility>
+#include <vector>
+
+namespace PVRHDHomeRun
+{
+
+// Decides which guide.php requests to make.
+//
+// The basic guide, of every channel, is due every guideBasicInterval,
+// staggered to arrive shortly before the hour, and at once whenever the
+// guide does not cover the current time.
+//
+// Every unfilled interval of each channel's extended guide is a job of at
+// most guideExtendedEach seconds, the most supplied by one request.  A
+// job's deadline is the start of the gap it fills, so the nearest gaps are
+// fetched first.  Each job is also held back by a random stagger, which
+// it keeps from one pass to the next until the gap is filled.  The jobs of
+// a pass stay queued, and are dispatched a few at a time, until the next.
+//
+// Gaps in the windows Kodi asks for are urgent, they are dispatched as
+// soon as possible and ahead of the rest.  A job is dispatched only once
+// until it is done, however often it is asked for.
+//
+// Not locked, PVR_HDHR holds _guide_lock.
+class GuideScheduler
+{
+public:
+    struct Job
+    {
+        uint32_t number;
+        time_t   start;  // Also the deadline
+        time_t   length;
+        bool     urgent;
+    };
+
+    // Returns true, and schedules the next one, if the basic guide is due.
+    bool BasicDue(time_t now, bool covered);
+
+    // The extended jobs are rebuilt on every pass from the requests of
+    // each channel.
+    void Begin();
+    void Add(uint32_t number, const IntervalSet& requests, time_t now);
+    // Up to 'max' jobs whose stagger has passed, earliest deadline first.
+    // The others are left for the next call.
+    std::vector<Job> Dispatch(time_t now, size_t max);
+
+    // A window Kodi asked for which the guide does not cover.
+    void Demand(uint32_t number, const Interval&);
+    // Up to 'max' urgent jobs, without waiting for the next pass.
+    std::vector<Job> DispatchDemand(size_t max);
+    // Every dispatched job must be marked done.
+    void Done(uint32_t number, time_t start);
+
+private:
+    int  _random();
+    void _start(const Job&);
+
+    struct Later
+    {
+        bool operator()(const Job& a, const Job& b) const
+        {
+            if (a.urgent != b.urgent)
+                return b.urgent;
+            return a.start > b.start;
+        }
+    };
+    struct Stagger
+    {
+        time_t ready;
+        bool   seen;
+    };
+
+    std::priority_queue<Job, std::vector<Job>, Later> _queue;
+    std::map<std::pair<uint32_t, time_t>, Stagger>    _stagger; // by channel and start
+    std::map<uint32_t, IntervalSet>                   _demand;
+    std::set<std::pair<uint32_t, time_t>>             _inflight;
+    std::default_random_engine _generator;
+    time_t _next_basic = 0;
+    bool   _prune      = false;
+};
+
+} // namespace PVRHDHomeRun
@@ -0,0 +1,125 @@
+/*
+ *      Copyright (C) 2017-2019 Matthew Lundberg <matthew.k.lundberg@gmail.com>
+ *      https://github.com/MatthewLundberg/pvr.hdhomerun
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include "HiddenChannels.h"
+
+namespace PVRHDHomeRun
+{
+
+HiddenChannels::Node::Node()
+{
+    for (auto& n : next)
+        n = -1;
+}
+
+int HiddenChannels::_branch(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c == '.')
+        return Dot;
+    return -1;
+}
+
+HiddenChannels::HiddenChannels(const std::set<std::string>& patterns)
+{
+    for (const auto& p : patterns)
+    {
+        _add(p);
+    }
+}
+
+void HiddenChannels::_add(const std::string& pattern)
+{
+    bool   wildcard = pattern.size() && pattern[pattern.size()-1] == '*';
+    size_t length   = wildcard ? pattern.size() - 1 : pattern.size();
+
+    // A guide number only contains digits and a dot, anything else never matches.
+    for (size_t i=0; i<length; i++)
+    {
+        if (_branch(pattern[i]) < 0)
+            return;
+    }
+
+    if (_nodes.empty())
+        _nodes.emplace_back();
+
+    int32_t node = 0;
+    for (size_t i=0; i<length; i++)
+    {
+        int b = _branch(pattern[i]);
+        if (_nodes[node].next[b] < 0)
+        {
+            _nodes[node].next[b] = static_cast<int32_t>(_nodes.size());
+            _nodes.emplace_back();
+        }
+        node = _nodes[node].next[b];
+    }
+
+    if (wildcard)
+        _nodes[node].prefix = true;
+    else
+        _nodes[node].exact = true;
+}
+
+bool HiddenChannels::Match(uint32_t channel, uint32_t subchannel) const
+{
+    if (_nodes.empty())
+        return false;
+
+    // Same format as GuideNumber::toString()
+    char text[24];
+    int  length = 0;
+    char digits[10];
+    int  n = 0;
+    do
+    {
+        digits[n++] = '0' + channel % 10;
+        channel /= 10;
+    } while (channel);
+    while (n)
+        text[length++] = digits[--n];
+
+    if (subchannel)
+    {
+        text[length++] = '.';
+        do
+        {
+            digits[n++] = '0' + subchannel % 10;
+            subchannel /= 10;
+        } while (subchannel);
+        while (n)
+            text[length++] = digits[--n];
+    }
+
+    int32_t node = 0;
+    for (int i=0; i<length; i++)
+    {
+        if (_nodes[node].prefix)
+            return true;
+        node = _nodes[node].next[_branch(text[i])];
+        if (node < 0)
+            return false;
+    }
+    return _nodes[node].prefix || _nodes[node].exact;
+}
+
+} // namespace PVRHDHomeRun
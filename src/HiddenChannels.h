@@ -0,0 +1,67 @@
+#pragma once
+/*
+ *      Copyright (C) 2017-2019 Matthew Lundberg <matthew.k.lundberg@gmail.com>
+ *      https://github.com/MatthewLundberg/pvr.hdhomerun
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+
+#include <cstdint>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace PVRHDHomeRun
+{
+
+// The hide_ch_no setting, compiled into a trie over the characters of the
+// formatted guide number ("5", "5.1").  An entry ending in '*' hides every
+// number starting with the rest of the entry.  Matching walks the trie
+// without formatting to a string, so it does not allocate.
+class HiddenChannels
+{
+public:
+    HiddenChannels() = default;
+    HiddenChannels(const std::set<std::string>& patterns);
+
+    bool Match(uint32_t channel, uint32_t subchannel) const;
+    bool Empty() const
+    {
+        return _nodes.empty();
+    }
+
+private:
+    static const int Dot      = 10;
+    static const int Branches = 11;
+
+    struct Node
+    {
+        Node();
+
+        int32_t next[Branches];
+        bool    exact  = false; // A pattern ends here
+        bool    prefix = false; // A wildcard pattern ends here
+    };
+
+    void _add(const std::string&);
+    static int _branch(char c);
+
+    std::vector<Node> _nodes;
+};
+
+} // namespace PVRHDHomeRun
@@ -0,0 +1,515 @@
+/*
+ *      Copyright (C) 2017-2019 Matthew Lundberg <matthew.k.lundberg@gmail.com>
+ *      https://github.com/MatthewLundberg/pvr.hdhomerun
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include "HttpClient.h"
+#include "Addon.h"
+#include "Utils.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+
+namespace PVRHDHomeRun
+{
+
+namespace
+{
+// Large enough that a guide or lineup response takes a handful of reads.
+const size_t ReadChunk = 64 * 1024;
+
+// The most reserved up front for a reported length, the rest grows as it
+// arrives.  A guide response is a few MB.
+const size_t ReserveLimit = 16 * 1024 * 1024;
+
+// Reused by every request made on the same thread.
+std::vector<char>& ThreadBuffer()
+{
+    thread_local std::vector<char> buffer(ReadChunk);
+    return buffer;
+}
+
+void* OpenURL(const std::string& url, int timeout)
+{
+    if (timeout <= 0)
+        return g.XBMC->OpenFile(url.c_str(), 0);
+
+    void* fileHandle = g.XBMC->CURLCreate(url.c_str());
+    if (fileHandle == nullptr)
+        return nullptr;
+
+    auto timeoutstr = std::to_string(timeout);
+    if (!g.XBMC->CURLAddOption(fileHandle, XFILE::CURLOPTIONTYPE::CURL_OPTION_PROTOCOL, "connection-timeout", timeoutstr.c_str())
+            || !g.XBMC->CURLOpen(fileHandle, 0))
+    {
+        g.XBMC->CloseFile(fileHandle);
+        return nullptr;
+    }
+    return fileHandle;
+}
+
+// Reads straight into content, presized from the length the server
+// reported.  One extra byte is left for the read which finds the end.
+void ReadAll(void* fileHandle, std::string& content)
+{
+    int64_t length = g.XBMC->GetFileLength(fileHandle);
+    content.resize(length > 0 ? std::min(static_cast<size_t>(length), ReserveLimit) + 1 : ReadChunk);
+
+    size_t used = 0;
+    for (;;)
+    {
+        if (used == content.size())
+            content.resize(content.size() * 2);
+
+        auto bytesRead = g.XBMC->ReadFile(fileHandle, &content[used], std::min(content.size() - used, ReadChunk));
+        if (bytesRead <= 0)
+            break;
+        used += bytesRead;
+    }
+    content.resize(used);
+}
+
+// hdhomerun_sock_recv fails alike at the end of the stream, on a reset and
+// on a timeout.  A reset shows only in the errno of the failed read, later
+// reads find the end.  After a timeout there is nothing to read, after the
+// end an empty read.
+bool AtEnd(hdhomerun_sock_t sock, int error)
+{
+    char c;
+    return error != ECONNRESET && recv(sock, &c, 1, MSG_PEEK) == 0;
+}
+
+std::string Lower(std::string s)
+{
+    std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) { return std::tolower(c); });
+    return s;
+}
+}
+
+bool VFSHttpClient::Get(const std::string& url, std::string& body, int timeout)
+{
+    body.clear();
+
+    void* fileHandle = OpenURL(url, timeout);
+    if (fileHandle == nullptr)
+    {
+        KODI_LOG(0, "GetFileContents: %s failed\n", url.c_str());
+        return false;
+    }
+
+    ReadAll(fileHandle, body);
+    g.XBMC->CloseFile(fileHandle);
+
+    return true;
+}
+
+bool VFSHttpClient::Stream(const std::string& url, const HttpSink& sink, int timeout)
+{
+    void* fileHandle = OpenURL(url, timeout);
+    if (fileHandle == nullptr)
+    {
+        KODI_LOG(0, "GetFileContents: %s failed\n", url.c_str());
+        return false;
+    }
+
+    auto& buffer = ThreadBuffer();
+
+    bool ok = true;
+    for (;;)
+    {
+        auto bytesRead = g.XBMC->ReadFile(fileHandle, buffer.data(), buffer.size());
+        if (bytesRead <= 0)
+            break;
+        if (!sink(buffer.data(), bytesRead))
+        {
+            ok = false;
+            break;
+        }
+    }
+
+    g.XBMC->CloseFile(fileHandle);
+
+    return ok;
+}
+
+PooledHttpClient::~PooledHttpClient()
+{
+    for (auto& host : _idle)
+    {
+        for (auto& c : host.second)
+        {
+            hdhomerun_sock_destroy(c.sock);
+        }
+    }
+}
+
+bool PooledHttpClient::Get(const std::string& url, std::string& body, int timeout)
+{
+    URL u;
+    if (_parse(url, u) && _direct(u))
+    {
+        body.clear();
+        auto result = _request(u, timeout, &body, nullptr);
+        if (result != HTTP_FALLBACK)
+            return result == HTTP_OK;
+    }
+    return _fallback.Get(url, body, timeout);
+}
+
+bool PooledHttpClient::Stream(const std::string& url, const HttpSink& sink, int timeout)
+{
+    URL u;
+    if (_parse(url, u) && _direct(u))
+    {
+        auto result = _request(u, timeout, nullptr, &sink);
+        if (result != HTTP_FALLBACK)
+            return result == HTTP_OK;
+    }
+    return _fallback.Stream(url, sink, timeout);
+}
+
+bool PooledHttpClient::_parse(const std::string& url, URL& u)
+{
+    static const std::string scheme = "http://";
+    if (url.compare(0, scheme.size(), scheme))
+        return false;
+
+    auto slash = url.find('/', scheme.size());
+    auto authority = url.substr(scheme.size(), slash == std::string::npos ? slash : slash - scheme.size());
+    u.path = slash == std::string::npos ? "/" : url.substr(slash);
+
+    // Credentials, or Kodi's "|option" suffix, are the VFS's business.
+    if (authority.empty() || authority.find('@') != std::string::npos || url.find('|') != std::string::npos)
+        return false;
+
+    auto colon = authority.find(':');
+    u.host = authority.substr(0, colon);
+    u.port = 80;
+    if (colon != std::string::npos)
+    {
+        int port = atoi(authority.c_str() + colon + 1);
+        if (port <= 0 || port > 65535)
+            return false;
+        u.port = static_cast<uint16_t>(port);
+    }
+    u.key = u.host + ":" + std::to_string(u.port);
+    return !u.host.empty();
+}
+
+bool PooledHttpClient::_direct(const URL& u)
+{
+    Lock lock(this);
+
+    auto it = _unreachable.find(u.key);
+    if (it == _unreachable.end())
+        return true;
+    if (it->second > time(nullptr))
+        return false;
+    _unreachable.erase(it);
+    return true;
+}
+
+// A kept connection may have been closed by the server while it was idle,
+// which shows as a failure before any response.  The request is then
+// tried once more on a new connection.
+PooledHttpClient::Result PooledHttpClient::_request(const URL& u, int timeout, std::string* body, const HttpSink* sink)
+{
+    for (int attempt = 0; attempt < 2; attempt++)
+    {
+        bool reused;
+        auto sock = _connect(u, timeout, reused);
+        if (sock == HDHOMERUN_SOCK_INVALID)
+            return HTTP_FAILED;
+
+        bool answered, reusable;
+        auto result = _exchange(sock, u, body, sink, answered, reusable);
+        if (reusable)
+            _release(u.key, sock);
+        else
+            hdhomerun_sock_destroy(sock);
+
+        if (result == HTTP_FAILED && reused && !answered)
+            continue;
+        return result;
+    }
+    return HTTP_FAILED;
+}
+
+PooledHttpClient::Result PooledHttpClient::_exchange(hdhomerun_sock_t sock, const URL& u,
+        std::string* body, const HttpSink* sink, bool& answered, bool& reusable)
+{
+    answered = false;
+    reusable = false;
+
+    std::string request = "GET " + u.path + " HTTP/1.1\r\n"
+            "Host: " + (u.port == 80 ? u.host : u.key) + "\r\n"
+            "Accept-Encoding: identity\r\n"
+            "Connection: keep-alive\r\n"
+            "\r\n";
+    if (!hdhomerun_sock_send(sock, request.data(), request.size(), _read_timeout))
+        return HTTP_FAILED;
+
+    // Received and not yet consumed
+    auto& buffer = ThreadBuffer();
+    std::string pending;
+    int error = 0; // errno of the last failed read
+    auto more = [&]() {
+        size_t n = buffer.size();
+        errno = 0;
+        if (!hdhomerun_sock_recv(sock, buffer.data(), &n, _read_timeout))
+        {
+            error = errno;
+            return false;
+        }
+        pending.append(buffer.data(), n);
+        return true;
+    };
+
+    size_t end;
+    while ((end = pending.find("\r\n\r\n")) == std::string::npos)
+    {
+        if (pending.size() > ReadChunk || !more())
+            return HTTP_FAILED;
+        answered = true;
+    }
+
+    int minor, status;
+    if (sscanf(pending.c_str(), "HTTP/1.%d %d", &minor, &status) != 2)
+        return HTTP_FAILED;
+    if (status != 200)
+    {
+        // Kodi's VFS follows redirects.
+        if (status / 100 == 3)
+            return HTTP_FALLBACK;
+        KODI_LOG(LOG_DEBUG, "HTTP %d from %s%s", status, u.key.c_str(), u.path.c_str());
+        return HTTP_FAILED;
+    }
+
+    bool    chunked = false;
+    bool    close   = minor == 0;
+    int64_t length  = -1;
+    for (size_t pos = pending.find("\r\n") + 2; pos < end; )
+    {
+        auto eol  = pending.find("\r\n", pos);
+        auto line = pending.substr(pos, eol - pos);
+        pos = eol + 2;
+
+        auto colon = line.find(':');
+        if (colon == std::string::npos)
+            continue;
+        auto name  = Lower(line.substr(0, colon));
+        auto value = Lower(line.substr(colon + 1));
+
+        if (name == "content-length")
+            length = strtoll(value.c_str(), nullptr, 10);
+        else if (name == "transfer-encoding")
+            chunked = value.find("chunked") != std::string::npos;
+        else if (name == "connection" && value.find("close") != std::string::npos)
+            close = true;
+        else if (name == "connection" && value.find("keep-alive") != std::string::npos)
+            close = false;
+    }
+    pending.erase(0, end + 4);
+
+    auto deliver = [&](size_t n) {
+        bool ok = true;
+        if (body)
+            body->append(pending, 0, n);
+        else
+            ok = (*sink)(pending.data(), n);
+        pending.erase(0, n);
+        return ok;
+    };
+    if (chunked)
+    {
+        for (;;)
+        {
+            size_t eol;
+            while ((eol = pending.find("\r\n")) == std::string::npos)
+            {
+                if (!more())
+                    return HTTP_FAILED;
+            }
+            size_t size = strtoul(pending.c_str(), nullptr, 16);
+            pending.erase(0, eol + 2);
+            if (size == 0)
+                break;
+
+            while (size)
+            {
+                if (pending.empty() && !more())
+                    return HTTP_FAILED;
+                size_t n = std::min(size, pending.size());
+                if (!deliver(n))
+                    return HTTP_FAILED;
+                size -= n;
+            }
+
+            // The CRLF after the chunk
+            while (pending.size() < 2)
+            {
+                if (!more())
+                    return HTTP_FAILED;
+            }
+            pending.erase(0, 2);
+        }
+        // Trailers, ending with an empty line
+        size_t eol;
+        while ((eol = pending.find("\r\n")) != 0)
+        {
+            if (eol != std::string::npos)
+                pending.erase(0, eol + 2);
+            else if (!more())
+                return HTTP_FAILED;
+        }
+        pending.erase(0, 2);
+    }
+    else if (length >= 0)
+    {
+        if (body)
+            body->reserve(std::min(static_cast<size_t>(length), ReserveLimit));
+        while (length > 0)
+        {
+            if (pending.empty() && !more())
+                return HTTP_FAILED;
+            size_t n = std::min(static_cast<size_t>(length), pending.size());
+            if (!deliver(n))
+                return HTTP_FAILED;
+            length -= n;
+        }
+    }
+    else
+    {
+        // Until the server closes the connection.  A timeout or a reset
+        // leaves the body cut short.
+        do
+        {
+            if (pending.size() && !deliver(pending.size()))
+                return HTTP_FAILED;
+        } while (more());
+        return AtEnd(sock, error) ? HTTP_OK : HTTP_FAILED;
+    }
+
+    reusable = !close && pending.empty();
+    return HTTP_OK;
+}
+
+hdhomerun_sock_t PooledHttpClient::_connect(const URL& u, int timeout, bool& reused)
+{
+    {
+        Lock lock(this);
+
+        time_t now = time(nullptr);
+        auto it = _idle.find(u.key);
+        while (it != _idle.end() && it->second.size())
+        {
+            auto c = it->second.back();
+            it->second.pop_back();
+            if (now - c.idle < IdleLifetime)
+            {
+                reused = true;
+                return c.sock;
+            }
+            hdhomerun_sock_destroy(c.sock);
+        }
+    }
+
+    reused = false;
+    auto sock = hdhomerun_sock_create_tcp();
+    if (sock == HDHOMERUN_SOCK_INVALID)
+        return sock;
+
+    uint32_t addr = _resolve(u.host, sock);
+    uint64_t ms   = static_cast<uint64_t>(timeout > 0 ? timeout : ConnectTimeout) * 1000;
+    if (!addr || !hdhomerun_sock_connect(sock, addr, u.port, ms))
+    {
+        KODI_LOG(LOG_DEBUG, "Cannot connect to %s, using the fallback for it", u.key.c_str());
+        _forget(u.host);
+        hdhomerun_sock_destroy(sock);
+
+        Lock lock(this);
+        _unreachable[u.key] = time(nullptr) + DNSLifetime;
+        return HDHOMERUN_SOCK_INVALID;
+    }
+    return sock;
+}
+
+void PooledHttpClient::_release(const std::string& key, hdhomerun_sock_t sock)
+{
+    Lock lock(this);
+
+    auto& idle = _idle[key];
+    if (idle.size() >= IdlePerHost)
+    {
+        hdhomerun_sock_destroy(idle.front().sock);
+        idle.erase(idle.begin());
+    }
+    idle.push_back({sock, time(nullptr)});
+}
+
+uint32_t PooledHttpClient::_resolve(const std::string& host, hdhomerun_sock_t sock)
+{
+    time_t now = time(nullptr);
+    {
+        Lock lock(this);
+        auto it = _dns.find(host);
+        if (it != _dns.end() && it->second.expires > now)
+            return it->second.addr;
+    }
+
+    // Without the lock, a lookup can take a while.
+    uint32_t addr = hdhomerun_sock_getaddrinfo_addr(sock, host.c_str());
+    if (addr)
+    {
+        Lock lock(this);
+        _dns[host] = {addr, now + DNSLifetime};
+    }
+    return addr;
+}
+
+void PooledHttpClient::_forget(const std::string& host)
+{
+    Lock lock(this);
+    _dns.erase(host);
+}
+
+namespace
+{
+std::atomic<HttpClient*> SetClient{nullptr};
+}
+
+HttpClient& DefaultHttpClient()
+{
+    static VFSHttpClient    vfs;
+    static PooledHttpClient pooled(vfs);
+
+    auto client = SetClient.load();
+    return client ? *client : pooled;
+}
+
+void SetDefaultHttpClient(HttpClient* client)
+{
+    SetClient = client;
+}
+
+} // namespace PVRHDHomeRun
@@ -0,0 +1,140 @@
+#pragma once
+/*
+ *      Copyright (C) 2017-2019 Matthew Lundberg <matthew.k.lundberg@gmail.com>
+ *      https://github.com/MatthewLundberg/pvr.hdhomerun
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include "Lockable.h"
+#include <hdhomerun.h>
+#include <cstdint>
+#include <ctime>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace PVRHDHomeRun
+{
+
+// Passed the body as it is read, stopping if it returns false.
+typedef std::function<bool(const char*, size_t)> HttpSink;
+
+// Fetches a URL.  The timeout, in seconds, is for connecting, 0 for the
+// default.
+class HttpClient
+{
+public:
+    virtual ~HttpClient() = default;
+
+    virtual bool Get(const std::string& url, std::string& body, int timeout) = 0;
+    virtual bool Stream(const std::string& url, const HttpSink& sink, int timeout) = 0;
+};
+
+// Kodi's VFS, a new handle for every request.  Anything Kodi can open.
+class VFSHttpClient : public HttpClient
+{
+public:
+    bool Get(const std::string& url, std::string& body, int timeout) override;
+    bool Stream(const std::string& url, const HttpSink& sink, int timeout) override;
+};
+
+// Plain HTTP GETs over connections kept open between requests, for the
+// handful of hosts asked again and again: the devices, and the guide and
+// rules API.  Host names are resolved once every DNSLifetime.
+//
+// Anything else, https or a file, a URL with Kodi's "|option" suffix, or
+// a redirect, is handed to the fallback.  Other failures are failures, the
+// fallback would only wait for the same timeout again.  A host which cannot
+// be connected to, which may need a proxy, is left to the fallback for
+// DNSLifetime.
+//
+// Requests are not pipelined, concurrent requests to a host each take a
+// connection of their own.
+class PooledHttpClient : public HttpClient, Lockable
+{
+public:
+    static const time_t   DNSLifetime   = 300;
+    static const time_t   IdleLifetime  = 20;
+    static const size_t   IdlePerHost   = 4;
+    static const uint64_t ReadTimeout   = 30000; // ms
+    static const int      ConnectTimeout = 5;    // s
+
+    PooledHttpClient(HttpClient& fallback, uint64_t readTimeout = ReadTimeout)
+        : _fallback(fallback)
+        , _read_timeout(readTimeout)
+    {}
+    ~PooledHttpClient();
+
+    PooledHttpClient(const PooledHttpClient&) = delete;
+    PooledHttpClient& operator=(const PooledHttpClient&) = delete;
+
+    bool Get(const std::string& url, std::string& body, int timeout) override;
+    bool Stream(const std::string& url, const HttpSink& sink, int timeout) override;
+
+private:
+    struct URL
+    {
+        std::string host;
+        uint16_t    port;
+        std::string path;
+        std::string key; // host:port
+    };
+    struct Connection
+    {
+        hdhomerun_sock_t sock;
+        time_t           idle; // Since
+    };
+    enum Result
+    {
+        HTTP_OK,
+        HTTP_FAILED,
+        HTTP_FALLBACK, // A redirect
+    };
+
+    static bool _parse(const std::string& url, URL&);
+    bool   _direct(const URL&);
+    Result _request(const URL&, int timeout, std::string* body, const HttpSink* sink);
+    Result _exchange(hdhomerun_sock_t, const URL&, std::string* body, const HttpSink* sink,
+            bool& answered, bool& reusable);
+
+    hdhomerun_sock_t _connect(const URL&, int timeout, bool& reused);
+    void             _release(const std::string& key, hdhomerun_sock_t);
+    uint32_t         _resolve(const std::string& host, hdhomerun_sock_t);
+    void             _forget(const std::string& host);
+
+    struct Address
+    {
+        uint32_t addr;
+        time_t   expires;
+    };
+
+    HttpClient& _fallback;
+    uint64_t    _read_timeout; // ms
+    std::map<std::string, std::vector<Connection>> _idle; // by host:port
+    std::map<std::string, Address>                 _dns;
+    std::map<std::string, time_t>                  _unreachable; // by host:port, until
+};
+
+// Pooled for http URLs, Kodi's VFS for the rest, unless another client has
+// been set.  The client set must outlive its use, nullptr restores the
+// default.
+HttpClient& DefaultHttpClient();
+void        SetDefaultHttpClient(HttpClient* client);
+
+} // namespace PVRHDHomeRun
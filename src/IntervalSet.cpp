@@ -23,6 +23,7 @@
 #include "Utils.h"
 #include "IntervalSet.h"
 
+#include <algorithm>
 #include <iostream>
 #include <sstream>
 #include <iterator>
@@ -46,112 +47,186 @@ std::string IntervalSet::toString() const
     return ss.str();
 }
 
-void IntervalSet::_rebalance()
+// Only the intervals overlapping or touching o are visited.
+void IntervalSet::Add(const Interval& o)
 {
-    auto it = _intervals.begin();
-    if (it == _intervals.end())
+    if (o._end <= o._start)
         return;
 
-    auto prev = it;
-    it ++;
+    time_t start = o._start;
+    time_t end   = o._end;
 
-    while (it != _intervals.end())
+    auto first = _intervals.upper_bound(o);
+    if (first != _intervals.begin())
     {
-        if (it->_start <= prev->_end)
-        {
-            auto& p = const_cast<Interval&>(*prev);
-
-            if (it->_end > p._end)
-                p._end = it->_end;
-
-            it = _intervals.erase(it);
-        }
-        else
+        auto prev = std::prev(first);
+        if (prev->_end >= start)
         {
-            prev = it;
-            it ++;
+            start = prev->_start;
+            end   = std::max(end, prev->_end);
+            first = prev;
         }
     }
+
+    auto last = first;
+    while (last != _intervals.end() && last->_start <= end)
+    {
+        end = std::max(end, last->_end);
+        last ++;
+    }
+
+    _intervals.erase(first, last);
+    _intervals.insert(last, {start, end});
 }
-void IntervalSet::Add(const Interval& o)
+void IntervalSet::Add(const IntervalSet& set)
 {
-    _intervals.insert(o);
-    _rebalance();
+    Add(std::vector<Interval>(set._intervals.begin(), set._intervals.end()));
 }
-void IntervalSet::Add(const IntervalSet& set)
+void IntervalSet::Add(const std::vector<Interval>& sorted)
 {
-    for (auto& o : set._intervals)
+    // A few intervals are cheaper to add one at a time.
+    if (sorted.size() * 8 < _intervals.size())
     {
-        _intervals.insert(o);
+        for (auto& o : sorted)
+        {
+            Add(o);
+        }
+        return;
     }
-    _rebalance();
-}
 
-void IntervalSet::Remove(const Interval& o)
-{
-    bool action;
-    do {
-        action = false;
+    std::vector<Interval> merged;
+    merged.reserve(_intervals.size() + sorted.size());
+    std::merge(_intervals.begin(), _intervals.end(), sorted.begin(), sorted.end(),
+            std::back_inserter(merged));
 
-        for (auto it = _intervals.begin(); it != _intervals.end(); it++)
-        {
-            auto& i = const_cast<Interval&>(*it);
-
-            if (o._end <= i._start)
-            {
-                // current interval start after removal end, done
-                break;
-            }
+    _intervals.clear();
+    for (auto& i : merged)
+    {
+        if (i._end <= i._start)
+            continue;
 
-            if (o._start >= i._end)
+        if (_intervals.size())
+        {
+            auto& last = const_cast<Interval&>(*_intervals.rbegin());
+            if (i._start <= last._end)
             {
-                // Current interval end before removal start
+                last._end = std::max(last._end, i._end);
                 continue;
             }
+        }
+        _intervals.insert(_intervals.end(), i);
+    }
+}
 
-            // o._end   > i._start
-            // o._start < i._end
+// Only the intervals overlapping o are visited.
+void IntervalSet::Remove(const Interval& o)
+{
+    if (o._end <= o._start)
+        return;
 
-            if (o._start <= i._start && o._end >= i._end)
-            {
-                // Covers entire interval, remove it
-                // Breaking out of loop, no need to update 'it'.
-                _intervals.erase(it);
-                action = true;
-                break;
-            }
-            else if (o._start > i._start && o._end < i._end)
-            {
-                // Interval to be removed resides inside this interval, split current interval
+    auto it = _intervals.upper_bound(o);
+    if (it != _intervals.begin())
+    {
+        auto prev = std::prev(it);
+        if (prev->_end > o._start)
+            it = prev;
+    }
 
-                _intervals.insert({o._end, i._end});
-                i._end = o._start;
-                action = true;
-                break;
-            }
-            else if (o._start <= i._start && o._end < i._end)
-            {
-                // o._end is within this interval, move start
+    while (it != _intervals.end() && it->_start < o._end)
+    {
+        Interval i = *it;
+        it = _intervals.erase(it);
 
-                i._start = o._end;
-                action = true;
-            }
-            else if (o._start > i._start && o._end >= i._end)
-            {
-                // o._start is within this interval, move end
+        // Keep whatever lies outside o
+        if (i._start < o._start)
+        {
+            _intervals.insert(it, {i._start, o._start});
+        }
+        if (i._end > o._end)
+        {
+            _intervals.insert(it, {o._end, i._end});
+            break;
+        }
+    }
+}
+void IntervalSet::Remove(const IntervalSet& set)
+{
+    Remove(std::vector<Interval>(set._intervals.begin(), set._intervals.end()));
+}
+void IntervalSet::Remove(const std::vector<Interval>& sorted)
+{
+    if (sorted.size() * 8 < _intervals.size())
+    {
+        for (auto& o : sorted)
+        {
+            Remove(o);
+        }
+        return;
+    }
+
+    // One pass over both.
+    std::set<Interval> result;
+    auto r = sorted.begin();
+    for (auto& i : _intervals)
+    {
+        // Removals ending before this interval cannot reach later ones.
+        while (r != sorted.end() && r->_end <= i._start)
+            r ++;
 
-                i._end = o._start;
-                action = true;
+        time_t start = i._start;
+        for (auto q = r; q != sorted.end() && q->_start < i._end; q++)
+        {
+            // An empty removal would split the interval in two.
+            if (q->_end <= q->_start)
+                continue;
+            if (q->_start > start)
+            {
+                result.insert(result.end(), {start, q->_start});
             }
+            start = std::max(start, q->_end);
+        }
+        if (start < i._end)
+        {
+            result.insert(result.end(), {start, i._end});
         }
-    } while (action);
+    }
+    _intervals.swap(result);
 }
-void IntervalSet::Remove(const IntervalSet& set)
+std::vector<Interval> IntervalSet::Overlap(const Interval& o) const
+{
+    std::vector<Interval> pieces;
+    if (o._end <= o._start)
+        return pieces;
+
+    auto it = _intervals.upper_bound(o);
+    if (it != _intervals.begin() && std::prev(it)->_end > o._start)
+        it --;
+    for (; it != _intervals.end() && it->_start < o._end; it++)
+    {
+        pieces.push_back({std::max(it->_start, o._start), std::min(it->_end, o._end)});
+    }
+    return pieces;
+}
+std::vector<Interval> IntervalSet::Gaps(const Interval& o) const
 {
-    for (auto& o: set._intervals)
+    std::vector<Interval> gaps;
+    time_t start = o._start;
+    for (auto& i : Overlap(o))
     {
-        Remove(o);
+        if (i._start > start)
+            gaps.push_back({start, i._start});
+        start = i._end;
     }
+    if (start < o._end)
+        gaps.push_back({start, o._end});
+    return gaps;
+}
+bool IntervalSet::Contains(time_t t) const
+{
+    auto it = _intervals.upper_bound({t, t});
+    if (it == _intervals.begin())
+        return false;
+    return std::prev(it)->Contains(t);
 }
 time_t IntervalSet::Length() const
 {
@@ -170,5 +245,33 @@ bool operator<(const Interval& a, const Interval& b)
     return a._start < b._start;
 }
 
+void IntervalSet::Save(SnapshotWriter& w) const
+{
+    w.Put(static_cast<uint32_t>(_intervals.size()));
+    for (auto& i : _intervals)
+    {
+        w.PutTime(i._start);
+        w.PutTime(i._end);
+    }
+}
+
+bool IntervalSet::Load(SnapshotReader& r)
+{
+    _intervals.clear();
+
+    uint32_t count;
+    if (!r.Count(count))
+        return false;
+    for (uint32_t n=0; n<count; n++)
+    {
+        time_t start, end;
+        if (!r.GetTime(start) || !r.GetTime(end))
+            return false;
+        // Add keeps the set disjoint even if the snapshot was not.
+        Add({start, end});
+    }
+    return true;
+}
+
 } //namespace PVRHDHomeRun
 
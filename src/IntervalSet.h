@@ -20,9 +20,11 @@
  *
  */
 
+#include "Snapshot.h"
 #include <ctime>
 #include <set>
 #include <string>
+#include <vector>
 
 namespace PVRHDHomeRun
 {
@@ -75,11 +77,14 @@ public:
         _intervals.insert(i);
     }
 
+    // Each costs O(log n) plus the intervals merged or split.
     void Add(const Interval&);
     void Add(const IntervalSet&);
-
     void Remove(const Interval&);
     void Remove(const IntervalSet&);
+    // Batches sorted by start, which may overlap, in one pass.
+    void Add(const std::vector<Interval>&);
+    void Remove(const std::vector<Interval>&);
 
     std::string toString() const;
     operator std::string() const
@@ -87,15 +92,10 @@ public:
         return toString();
     }
 
-    bool Contains(time_t t) const
-    {
-        for (auto& i : _intervals)
-        {
-            if (i.Contains(t))
-                return true;
-        }
-        return false;
-    }
+    bool Contains(time_t t) const;
+    // The parts of o inside, and outside, the set.
+    std::vector<Interval> Overlap(const Interval& o) const;
+    std::vector<Interval> Gaps(const Interval& o) const;
     time_t Length() const;
     bool Empty() const
     {
@@ -121,8 +121,11 @@ public:
     {
         return _intervals;
     }
+
+    void Save(SnapshotWriter&) const;
+    bool Load(SnapshotReader&);
 private:
-    void _rebalance();
+    // Disjoint and not touching, sorted by start.
     std::set<Interval> _intervals;
 };
 
@@ -25,6 +25,7 @@
 #include "Addon.h"
 #include "Utils.h"
 #include "PVR_HDHR.h"
+#include "WorkerPool.h"
 #include <chrono>
 #include <functional>
 #include <algorithm>
@@ -53,103 +54,251 @@ PVR_HDHR* PVR_HDHR_Factory(int protocol) {
 
 PVR_HDHR::~PVR_HDHR()
 {
-    for (auto device: _tuner_devices)
+    _discovery.StopThread();
+}
+
+bool PVR_HDHR::DiscoverTunerDevices()
+{
+    std::vector<DiscoveryEvent> events;
+    _discovery.Broadcast(events);
+
+    return _apply_discovery_events(events);
+}
+
+bool PVR_HDHR::HandleDiscoveryEvents()
+{
+    std::vector<DiscoveryEvent> events;
+    if (!_discovery.TakeEvents(events))
+        return false;
+
+    return _apply_discovery_events(events);
+}
+
+void PVR_HDHR::StartDiscovery()
+{
+    _discovery.CreateThread(false);
+}
+
+namespace
+{
+std::string snapshot_path()
+{
+    return g.userPath + "/state.bin";
+}
+}
+
+void PVR_HDHR::SaveSnapshot()
+{
+    SnapshotWriter w;
     {
-        delete device;
+        Lock guidelock(_guide_lock);
+        Lock pvrlock(_pvr_lock);
+
+        _devices.Save(w);
+        _lineup.Save(w, _devices);
+
+        w.Put(static_cast<uint32_t>(_guide.Size()));
+        for (size_t i=0; i<_guide.Size(); i++)
+        {
+            w.Put(_guide.ID(i));
+            _guide.At(i).Save(w);
+        }
+        _recording.Save(w);
     }
-    for (auto device: _storage_devices)
+
+    // The file is written without holding the locks.
+    g.XBMC->CreateDirectory(g.userPath.c_str());
+    auto path = snapshot_path();
+    if (WriteSnapshotFile(path, w))
     {
-        delete device;
+        KODI_LOG(LOG_DEBUG, "Saved %u bytes of state to %s", static_cast<unsigned>(w.Data().size()), path.c_str());
     }
 }
 
-bool PVR_HDHR::DiscoverTunerDevices()
+bool PVR_HDHR::LoadSnapshot()
 {
-    struct hdhomerun_discover_device_t discover_devices[64];
-    size_t device_count = hdhomerun_discover_find_devices_custom_v2(
-            0,
-            HDHOMERUN_DEVICE_TYPE_WILDCARD,
-            HDHOMERUN_DEVICE_ID_WILDCARD,
-            discover_devices,
-            64
-            );
+    std::string payload;
+    auto path = snapshot_path();
+    if (!ReadSnapshotFile(path, payload))
+        return false;
 
-    KODI_LOG(LOG_DEBUG, "PVR_HDHR::DiscoverTunerDevices Found %d devices", device_count);
+    SnapshotReader r(payload);
 
-    if (device_count == 0)
+    Lock guidelock(_guide_lock);
+    Lock pvrlock(_pvr_lock);
+
+    if (!_load_snapshot(r) || !r.AtEnd())
     {
-        // Sometimes no devices are found when waking from sleep, causing a
-        // lot of unnecessary network traffic as they are rediscovered.
-        // TODO:  Handle the case where all devices go away?
-        return true;
+        KODI_LOG(LOG_INFO, "Discarding unreadable state from %s", path.c_str());
+        _devices.Clear();
+        _lineup.Clear();
+        _guide.Clear();
+        _guide_wanted = 0;
+        _recording = Recording();
+        return false;
     }
 
-    std::set<uint32_t>    discovered_ids;  // Tuner IDs
-    std::set<std::string> discovered_urls; // Storage URLs
+    // Stale devices are removed by discovery, stale channels and guide
+    // entries by the first lineup and guide updates.
+    for (const auto& tuner : _devices.Tuners())
+    {
+        _discovery.Seed(tuner.second->DiscoverDevice());
+    }
+    for (const auto& storage : _devices.Storage())
+    {
+        _discovery.Seed(storage.second->DiscoverDevice());
+    }
+    for (size_t i=0; i<_lineup.Size(); i++)
+    {
+        auto number = _lineup.ID(i);
+        DeviceRegistry::ForEachSlot(_lineup.Devices(i), [&](unsigned slot) {
+            _devices.AddChannel(_devices.TunerAt(slot)->DeviceID(), number);
+        });
+    }
 
-    bool device_added    = false;
-    bool device_removed  = false;
-    bool storage_added   = false;
-    bool storage_removed = false;
+    _publish_channels();
 
-    Lock guidelock(_guide_lock);
-    Lock pvrlock(_pvr_lock);
-    for (size_t i=0; i<device_count; i++)
+    KODI_LOG(LOG_INFO, "Loaded state from %s: %u tuners, %u channels, %u recordings",
+            path.c_str(),
+            static_cast<unsigned>(_devices.DeviceCount()),
+            static_cast<unsigned>(_lineup.Size()),
+            static_cast<unsigned>(_recording.size())
+    );
+    return true;
+}
+
+bool PVR_HDHR::_load_snapshot(SnapshotReader& r)
+{
+    // _guide_lock and _pvr_lock held
+    if (!_devices.Load(r))
+        return false;
+
+    if (!_lineup.Load(r, _devices))
+        return false;
+
+    uint32_t count;
+    if (!r.Count(count))
+        return false;
+    for (uint32_t n=0; n<count; n++)
     {
-        auto& dd = discover_devices[i];
+        uint32_t id;
+        if (!r.Get(id))
+            return false;
+        auto& guide = _guide.Insert(id);
+        if (!guide.Load(r))
+            return false;
+        _guide.QueueAgeOut(id);
+        _guide_wanted = std::max(_guide_wanted, guide.Wanted());
+    }
 
+    return _recording.Load(r);
+}
+
+bool PVR_HDHR::_apply_discovery_events(const std::vector<DiscoveryEvent>& events)
+{
+    // Only the latest event for each device matters.
+    std::map<std::string, const DiscoveryEvent*> latest;
+    for (auto& event : events)
+    {
+        auto& dd = event.device;
         if (dd.device_type == HDHOMERUN_DEVICE_TYPE_STORAGE)
         {
+            latest[dd.base_url] = &event;
+        }
+        else
+        {
+            latest[std::to_string(dd.device_id)] = &event;
+        }
+    }
 
+    std::set<uint32_t>    removed_ids;  // Tuner IDs
+    std::set<std::string> removed_urls; // Storage URLs
+    std::vector<DiscoveredDevice> discovered;
+
+    for (auto& l : latest)
+    {
+        auto& event   = *l.second;
+        auto& dd      = event.device;
+        bool  removed = event.type == DiscoveryEvent::REMOVED;
+
+        if (dd.device_type == HDHOMERUN_DEVICE_TYPE_STORAGE)
+        {
             const auto url = dd.base_url;
-            discovered_urls.insert(url);
-            if (!g.Settings.record)
+            if (!removed && !g.Settings.record)
             {
                 std::cout << "Record: " << g.Settings.record << " Not using " << url << std::endl;
-                continue;
+                removed = true;
             }
-
-            if (_storage_urls.find(url) == _storage_urls.end())
-            {
-                storage_added = true;
-                KODI_LOG(LOG_DEBUG, "Adding storage %s", url);
-                std::cout << "New Storage URL " << url << std::endl;
-
-                _storage_urls.insert(url);
-                _storage_devices.insert(New_StorageDevice(&dd));
-            }
-            else
+            if (removed)
             {
-                KODI_LOG(LOG_DEBUG, "Known storage %s", url);
-                for (auto s: _storage_devices)
-                {
-                    if (!strcmp(s->BaseURL(), url))
-                    {
-                        s->Refresh(&dd);
-                    }
-                }
+                removed_urls.insert(url);
+                continue;
             }
         }
-        else if (dd.device_type = HDHOMERUN_DEVICE_TYPE_TUNER)
+        else
         {
             auto  id = dd.device_id;
 
-
-            if (g.Settings.blacklistDevice.find(id) != g.Settings.blacklistDevice.end())
+            if (!removed && g.Settings.blacklistDevice.find(id) != g.Settings.blacklistDevice.end())
             {
                 KODI_LOG(LOG_INFO, "Ignoring blacklisted device %08x", id);
-                continue;
+                removed = true;
             }
-
-            if (dd.is_legacy && !g.Settings.UseLegacyDevices())
+            if (!removed && dd.is_legacy && !g.Settings.UseLegacyDevices())
             {
                 KODI_LOG(LOG_INFO, "Ignoring legacy device %08x", id);
+                removed = true;
+            }
+            if (removed)
+            {
+                removed_ids.insert(id);
                 continue;
             }
+        }
+        discovered.emplace_back(dd);
+    }
 
-            discovered_ids.insert(id);
+    // Fetch discover.json from every device concurrently, without holding the locks.
+    ParallelFor(discovered.size(), g.Settings.deviceRefreshWorkers,
+            [&discovered](size_t i) {
+        auto& d = discovered[i];
+        FetchDiscoverData(d.device.base_url, d.discover, g.Settings.deviceRefreshTimeout);
+    });
+
+    bool device_added    = false;
+    bool device_removed  = false;
+    bool storage_added   = false;
+    bool storage_removed = false;
 
-            if (_device_ids.find(id) == _device_ids.end())
+    Lock guidelock(_guide_lock);
+    Lock pvrlock(_pvr_lock);
+    for (auto& d : discovered)
+    {
+        auto& dd = d.device;
+
+        if (dd.device_type == HDHOMERUN_DEVICE_TYPE_STORAGE)
+        {
+            const auto url = dd.base_url;
+            if (!_devices.FindStorageURL(url))
+            {
+                storage_added = true;
+                KODI_LOG(LOG_DEBUG, "Adding storage %s", url);
+                std::cout << "New Storage URL " << url << std::endl;
+
+                _devices.AddStorage(New_StorageDevice(dd, d.discover));
+            }
+            else
+            {
+                KODI_LOG(LOG_DEBUG, "Known storage %s", url);
+                _devices.RefreshStorage(dd, d.discover);
+            }
+        }
+        else
+        {
+            auto  id     = dd.device_id;
+            auto  device = _devices.FindTuner(id);
+
+            if (!device)
             {
                 // New device
                 device_added = true;
@@ -160,116 +309,210 @@ bool PVR_HDHR::DiscoverTunerDevices()
                         << " URL " << dd.base_url
                         << "\n";
 
-                _tuner_devices.insert(New_TunerDevice(&dd));
-                _device_ids.insert(id);
+                _devices.AddTuner(New_TunerDevice(dd, d.discover));
             }
             else
             {
                 KODI_LOG(LOG_DEBUG, "Known device %08x", id);
-
-                for (auto t: _tuner_devices)
-                {
-                    if (t->DeviceID() == id)
-                    {
-                        t->Refresh(&dd);
-                    }
-                }
+                device->Refresh(dd, d.discover);
             }
         }
     }
 
-    // Iterate through devices, Refresh and determine if there are stale entries.
-    auto sit = _storage_devices.begin();
-    while (sit != _storage_devices.end())
+    // Remove devices which have gone away.
+    for (const auto& url : removed_urls)
     {
-        auto storage = *sit;
-        const auto url = storage->BaseURL();
-        if (discovered_urls.find(url) == discovered_urls.end())
+        if (_devices.RemoveStorageURL(url))
         {
             storage_removed = true;
-            sit = _storage_devices.erase(sit);
-            _storage_urls.erase(url);
-            delete(storage);
+            KODI_LOG(LOG_DEBUG, "Removing storage %s", url.c_str());
         }
-        else
-            sit ++;
     }
 
-    auto tit = _tuner_devices.begin();
-    while (tit != _tuner_devices.end())
+    for (auto id : removed_ids)
     {
-        auto device = *tit;
-        uint32_t id = device->DeviceID();
-        if (discovered_ids.find(id) == discovered_ids.end())
-        {
-            // Device went away
-            device_removed = true;
-            KODI_LOG(LOG_DEBUG, "Removing device %08x", id);
+        auto device = _devices.FindTuner(id);
+        if (!device)
+            continue;
+
+        // Device went away
+        device_removed = true;
+        KODI_LOG(LOG_DEBUG, "Removing device %08x", id);
 
-            auto pdevice = const_cast<TunerDevice*>(device);
+        // Only the channels this device received need to be visited.
+        auto slot     = _devices.Slot(id);
+        auto channels = _devices.Channels(id);
+        for (auto number : channels)
+        {
+            auto i = _lineup.Find(number);
+            if (i == ChannelTable::npos)
+                continue;
 
-            auto nit = _lineup.begin();
-            while (nit != _lineup.end())
+            if (_lineup.RemoveDevice(i, slot))
             {
-                auto& number = *nit;
-                auto& info = _info[number];
-                if (info.RemoveDevice(device))
-                {
-                    KODI_LOG(LOG_DEBUG, "Removed device from GuideNumber %s", number.extendedName().c_str());
-                }
-                if (info.DeviceCount() == 0)
-                {
-                    // No devices left for this lineup guide entry, remove it
-                    KODI_LOG(LOG_DEBUG, "No devices left, removing GuideNumber %s", number.extendedName().c_str());
-                    nit = _lineup.erase(nit);
-                    _guide.erase(number);
-                    _info.erase(number);
-                }
-                else
-                    nit ++;
+                KODI_LOG(LOG_DEBUG, "Removed device from GuideNumber %s", _lineup.Number(i).c_str());
+            }
+            if (_lineup.Devices(i) == 0)
+            {
+                // No devices left for this lineup guide entry, remove it
+                KODI_LOG(LOG_DEBUG, "No devices left, removing GuideNumber %s", _lineup.Number(i).c_str());
+                _lineup.Erase(i);
+                _guide.Erase(number);
             }
-
-            // Erase device from this
-            tit = _tuner_devices.erase(tit);
-            _device_ids.erase(id);
-            delete(device);
-        }
-        else
-        {
-            tit ++;
         }
+
+        _devices.RemoveTuner(id);
+        _lineup_hash.erase(id);
+    }
+
+    if (device_removed)
+    {
+        _publish_channels();
     }
 
     return device_added || device_removed;
 }
 
-void PVR_HDHR::AddLineupEntry(const Json::Value& v, TunerDevice* device)
+namespace
+{
+bool hidden_channel(const GuideNumber& number, const HiddenChannels& hidden)
 {
-    GuideNumber number = v;
     if ((g.Settings.hideUnknownChannels) && (number._guidename == "Unknown"))
     {
+        return true;
+    }
+    return hidden.Match(number._channel, number._subchannel);
+}
+
+// One device's lineup, fetched and parsed without holding _pvr_lock.
+struct LineupFetch
+{
+    DeviceRegistry::TunerHandle device;
+    std::string                 url;
+    bool                        known  = false; // prior hash is valid
+    size_t                      prior  = 0;
+    size_t                      hash   = 0;
+    bool                        parsed = false;
+    std::vector<LineupEntry>    entries;
+};
+
+void fetch_lineup(LineupFetch& f)
+{
+    KODI_LOG(LOG_DEBUG, "Requesting channel lineup for %08x: %s",
+            f.device->DeviceID(), f.url.c_str()
+    );
+
+    std::string lineupStr;
+    if (!GetFileContents(f.url, lineupStr))
+    {
+        KODI_LOG(LOG_ERROR, "Cannot get lineup from %s", f.url.c_str());
+        return;
+    }
+
+    // Lineups rarely change, skip parsing when the response is the same.
+    f.hash = std::hash<std::string>()(lineupStr);
+    if (f.known && f.hash == f.prior)
+    {
+        KODI_LOG(LOG_DEBUG, "Lineup unchanged for %08x", f.device->DeviceID());
+        return;
+    }
+
+    Json::Value lineupJson;
+    std::string err;
+    if (!StringToJson(lineupStr, lineupJson, err))
+    {
+        KODI_LOG(LOG_ERROR, "Cannot parse JSON value returned from %s - %s", f.url.c_str(), err.c_str());
         return;
     }
-    auto numberstr = number.toString();
 
-    for (const auto& hidden: g.Settings.hiddenChannels)
+    if (lineupJson.type() != Json::arrayValue)
     {
-        if (hidden.size() && hidden[hidden.size()-1] == '*')
+        KODI_LOG(LOG_ERROR, "Lineup is not a JSON array, returned from %s", f.url.c_str());
+        return;
+    }
+
+    auto hidden = std::atomic_load(&g.Settings.hiddenChannelMatcher);
+
+    f.entries.reserve(lineupJson.size());
+    for (auto& v : lineupJson)
+    {
+        LineupEntry entry(v);
+        if (!hidden_channel(entry.number, *hidden))
         {
-            auto sz = hidden.size() - 1;
-            if (hidden.substr(0, sz) == numberstr.substr(0, sz))
-                return;
+            f.entries.push_back(std::move(entry));
         }
-        if (hidden == numberstr)
-        	return;
     }
-    _lineup.insert(number);
-    if (_info.find(number) == _info.end())
+    f.parsed = true;
+}
+}
+
+bool PVR_HDHR::AddLineupEntry(const LineupEntry& entry, TunerDevice* device, std::set<uint32_t>& seen)
+{
+    const auto& number = entry.number;
+    seen.insert(number);
+
+    bool added;
+    auto i = _lineup.Insert(number, added);
+
+    // Favorite is not part of the lineup.
+    uint8_t flags   = (_lineup.Flags(i) & ChannelTable::FAVORITE) | entry.flags;
+    bool    changed = added;
+    if (added || flags != _lineup.Flags(i)
+            || _lineup.Number(i) != number._guidenumber || _lineup.Name(i) != number._guidename)
+    {
+        _lineup.SetFlags(i, flags);
+        _lineup.SetNames(i, number._guidenumber, number._guidename);
+        changed = true;
+    }
+    // Another device receiving the channel is not a visible change.
+    _lineup.AddDevice(i, _devices.Slot(device->DeviceID()), entry.url);
+    _devices.AddChannel(device->DeviceID(), number);
+
+    return changed;
+}
+
+bool PVR_HDHR::_merge_lineup(TunerDevice* device, const std::vector<LineupEntry>& entries)
+{
+    // _pvr_lock held
+    auto id    = device->DeviceID();
+    auto slot  = _devices.Slot(id);
+    auto prior = _devices.Channels(id);
+
+    bool changed = false;
+    std::set<uint32_t> seen;
+    for (auto& entry : entries)
     {
-        Info info = v;
-        _info[number] = info;
+        if (AddLineupEntry(entry, device, seen))
+            changed = true;
     }
-    _info[number].AddDevice(device, v["URL"].asString());
+
+    for (auto number : prior)
+    {
+        if (seen.find(number) != seen.end())
+            continue;
+
+        _devices.RemoveChannel(id, number);
+        auto i = _lineup.Find(number);
+        if (i == ChannelTable::npos)
+            continue;
+
+        _lineup.RemoveDevice(i, slot);
+        if (_lineup.Devices(i) == 0)
+        {
+            KODI_LOG(LOG_DEBUG, "Lineup Entry removed: %s", _lineup.Number(i).c_str());
+            _lineup.Erase(i);
+            changed = true;
+        }
+    }
+
+    return changed;
+}
+
+void PVR_HDHR::InvalidateLineup()
+{
+    Lock pvrlock(_pvr_lock);
+    _lineup_hash.clear();
+    _lineup_generation++;
 }
 
 bool PVR_HDHR::UpdateRecordings()
@@ -277,8 +520,9 @@ bool PVR_HDHR::UpdateRecordings()
     Lock pvrlock(_pvr_lock);
 
     _recording.UpdateBegin();
-    for (const auto dev: _storage_devices)
+    for (const auto& storage: _devices.Storage())
     {
+        auto& dev = storage.second;
         std::string s;
         if (GetFileContents(dev->StorageURL(), s))
         {
@@ -298,7 +542,7 @@ bool PVR_HDHR::UpdateRules()
     Lock pvrlock(_pvr_lock);
 
     _recording.UpdateBegin();
-    TunerSet* ts = this;
+    TunerSet* ts = &_devices;
     if (ts->DeviceCount())
     {
         std::string URL{"http://api.hdhomerun.com/api/recording_rules?DeviceAuth="};
@@ -331,318 +575,398 @@ bool PVR_HDHR::UpdateLineup()
 {
     KODI_LOG(LOG_DEBUG, "PVR_HDHR::UpdateLineup");
 
-    Lock pvrlock(_pvr_lock);
-    std::set<GuideNumber> prior;
-    std::copy(_lineup.begin(), _lineup.end(), std::inserter(prior, prior.begin()));
-
-    _lineup.clear();
-
-    for (auto device: _tuner_devices)
+    std::vector<LineupFetch> fetches;
+    uint64_t generation;
     {
-
-        KODI_LOG(LOG_DEBUG, "Requesting channel lineup for %08x: %s",
-                device->DeviceID(), device->LineupURL().c_str()
-        );
-
-        std::string lineupStr;
-        if (!GetFileContents(device->LineupURL(), lineupStr))
+        Lock pvrlock(_pvr_lock);
+        generation = _lineup_generation;
+        for (const auto& tuner: _devices.Tuners())
         {
-            KODI_LOG(LOG_ERROR, "Cannot get lineup from %s", device->LineupURL().c_str());
-            continue;
+            LineupFetch f;
+            f.device = tuner.second;
+            f.url    = tuner.second->LineupURL();
+
+            auto hit = _lineup_hash.find(tuner.first);
+            if (hit != _lineup_hash.end())
+            {
+                f.known = true;
+                f.prior = hit->second;
+            }
+            fetches.push_back(std::move(f));
         }
+    }
 
-        Json::Value lineupJson;
-        std::string err;
-        if (!StringToJson(lineupStr, lineupJson, err))
-        {
-            KODI_LOG(LOG_ERROR, "Cannot parse JSON value returned from %s - %s", device->LineupURL().c_str(), err.c_str());
+    // Fetch and parse all lineups concurrently, without holding the lock.
+    ParallelFor(fetches.size(), g.Settings.lineupWorkers,
+            [&fetches](size_t i) {
+        fetch_lineup(fetches[i]);
+    });
+
+    // Merge everything in one pass, so readers never see a partial lineup.
+    Lock pvrlock(_pvr_lock);
+
+    bool changed = false;
+    for (auto& f : fetches)
+    {
+        if (!f.parsed)
             continue;
-        }
 
-        if (lineupJson.type() != Json::arrayValue)
-        {
-            KODI_LOG(LOG_ERROR, "Lineup is not a JSON array, returned from %s", device->LineupURL().c_str());
+        // The device may have been removed or replaced during the fetch.
+        auto id = f.device->DeviceID();
+        if (_devices.FindTuner(id) != f.device)
             continue;
-        }
 
-        for (auto& v : lineupJson)
+        if (_merge_lineup(f.device.get(), f.entries))
         {
-            AddLineupEntry(v, device);
+            changed = true;
         }
+        // Filtered with a hidden channel list replaced during the fetch,
+        // the next update must parse it again.
+        if (generation == _lineup_generation)
+            _lineup_hash[id] = f.hash;
     }
 
-    bool added = false;
-    for (const auto& number: _lineup)
+    if (changed)
     {
-        auto& info = _info[number];
-        std::string devices = info.IDString();
+        _publish_channels();
 
-        if (prior.find(number) == prior.end())
+        for (size_t i=0; i<_lineup.Size(); i++)
         {
-            added = true;
-
+            GuideNumber number{_lineup.ID(i)};
             KODI_LOG(LOG_DEBUG,
-                    "New Lineup Entry: %d.%d - %s - %s - %s",
+                    "Lineup Entry: %d.%d - %s - %s - %s",
                     number._channel,
                     number._subchannel,
-                    number._guidenumber.c_str(),
-                    number._guidename.c_str(),
-                    devices.c_str()
+                    _lineup.Number(i).c_str(),
+                    _lineup.Name(i).c_str(),
+                    _devices.IDString(_lineup.Devices(i)).c_str()
             );
         }
     }
-    if (added)
-    {
-        return true;
-    }
-
-    for (const auto& number: prior)
-    {
-        if (_lineup.find(number) == _lineup.end())
-            return true;
-    }
 
-    return false;
+    return changed;
 }
 
 void PVR_HDHR::_age_out(time_t now)
 {
+    // Only the guide is touched.
     Lock guidelock(_guide_lock);
-    Lock pvrlock(_pvr_lock);
 
-    for (auto& mapentry : _guide)
-    {
-        uint32_t id = mapentry.first;
-        auto& guide = mapentry.second;
-        guide._age_out(id, now);
-    }
+    _guide.AgeOut(now);
 }
 
-void PVR_HDHR::_insert_json_guide_data(const Json::Value& jsondeviceguide, const char* idstr)
+// Commits one channel at a time, so EPG queries wait for at most one merge.
+void PVR_HDHR::_insert_guide_data(std::vector<GuideParser::Channel>& channels)
 {
-    Lock pvrlock(_pvr_lock);
-
-    if (jsondeviceguide.type() != Json::arrayValue)
+    bool new_guide = false;
+    for (auto& channel : channels)
     {
-        KODI_LOG(LOG_ERROR, "Top-level JSON guide data is not an array for %s", idstr);
-        return;
-    }
+        Lock guidelock(_guide_lock);
+        Lock pvrlock(_pvr_lock);
 
-    for (auto& jsonchannelguide : jsondeviceguide)
-    {
-        GuideNumber number = jsonchannelguide;
+        const auto& number = channel.number;
 
-        if (_guide.find(number) == _guide.end())
+        Guide* channelguide = _guide.Find(number);
+        if (!channelguide)
         {
             KODI_LOG(LOG_DEBUG, "Inserting guide for channel %u", number.ID());
-            _guide.emplace(number, jsonchannelguide);
-        }
-
-        Guide& channelguide = _guide[number];
+            new_guide = true;
 
-        auto jsonguidenetries = jsonchannelguide["Guide"];
-        if (jsonguidenetries.type() != Json::arrayValue)
-        {
-            KODI_LOG(LOG_ERROR, "Guide entries is not an array for %s", idstr);
-            continue;
+            channelguide = &_guide.Insert(number);
+            channelguide->SetNames(number._guidename, channel.affiliate, channel.imageURL);
         }
 
-        bool new_channel_entries{false};
-
-        for (auto& jsonentry: jsonguidenetries)
+        for (auto& entry: channel.entries)
         {
-            static uint32_t counter = 1;
-
-            GuideEntry entry{jsonentry};
-            bool n = channelguide.AddEntry(entry, number.ID());
+            channelguide->AddEntry(entry);
         }
+        channelguide->Notify(number.ID());
+        _guide.QueueAgeOut(number);
+    }
 
+    // Channel names and icons come from the guide.
+    if (new_guide)
+    {
+        Lock pvrlock(_pvr_lock);
+        _publish_channels();
     }
 }
 
-void PVR_HDHR::_fetch_guide_data(const uint32_t* number, time_t start)
+bool PVR_HDHR::_plan_guide_request(GuideRequest& request)
 {
-    TunerSet* ts;
-    if (number)
-        ts = &_info[*number];
-    else
-        ts = this;
+    // _pvr_lock held
 
-    if (!ts->DeviceCount())
-        return;
+    // A single channel is requested on behalf of the tuners receiving it.
+    DeviceRegistry::DeviceMask mask = ~DeviceRegistry::DeviceMask(0);
+    if (request.number)
+    {
+        auto i = _lineup.Find(request.number);
+        mask = (i == ChannelTable::npos) ? 0 : _lineup.Devices(i);
+    }
+    TunerSubset ts(_devices, mask);
+
+    if (!ts.DeviceCount())
+        return false;
+
+    request.auth = ts.AuthString();
+    request.ids  = ts.IDString();
+    return true;
+}
 
+// Fetches and parses without any lock held.
+GuideFetchResult PVR_HDHR::_fetch_guide_data(const GuideRequest& request, GuideParser& parser)
+{
     std::string URL{"http://my.hdhomerun.com/api/guide.php?DeviceAuth="};
-    auto authstring = ts->AuthString();
-    auto idstring   = ts->IDString();
-    URL.append(EncodeURL(authstring));
+    URL.append(EncodeURL(request.auth));
 
-    if (number)
+    if (request.number)
     {
-        GuideNumber gn{*number};
+        GuideNumber gn{request.number};
         URL.append("&Channel=");
         URL.append(gn.toString());
 
-        if (start)
+        if (request.start)
         {
             URL.append("&Start=");
-            URL.append(std::to_string(start));
+            URL.append(std::to_string(request.start));
         }
     }
     KODI_LOG(LOG_DEBUG, "Requesting guide for %s: %s %s",
-            idstring.c_str(), start?FormatTime(start).c_str():"", URL.c_str());
+            request.ids.c_str(), request.start?FormatTime(request.start).c_str():"", URL.c_str());
 
-    std::string guidedata;
-    if (!GetFileContents(URL, guidedata))
+    // Parsed as it arrives, the response is never held in full.
+    bool read = StreamFileContents(URL, [&](const char* data, size_t size) {
+        return parser.Feed(data, size);
+    });
+    if (!read && parser.Error().empty())
     {
         KODI_LOG(LOG_ERROR, "Error requesting guide for %s from %s",
-                idstring.c_str(), URL.c_str());
-        return;
+                request.ids.c_str(), URL.c_str());
+        return GUIDE_UNAVAILABLE;
     }
-    if (guidedata.substr(0,4) == "null")
-        return;
-
-    Json::Value jsondeviceguide;
-    std::string err;
-    if (!StringToJson(guidedata, jsondeviceguide, err))
+    if (!parser.Finish())
     {
-        KODI_LOG(LOG_ERROR, "Error parsing JSON guide data for %s - %s", idstring.c_str(), err.c_str());
-        return;
+        KODI_LOG(LOG_ERROR, "Error parsing JSON guide data for %s - %s", request.ids.c_str(), parser.Error().c_str());
+        return parser.Incomplete() ? GUIDE_UNAVAILABLE : GUIDE_INVALID;
     }
-    _insert_json_guide_data(jsondeviceguide, idstring.c_str());
+    return GUIDE_FETCHED;
 }
 
 bool PVR_HDHR::_guide_contains(time_t t)
 {
     // guidelock held.
-    for (auto& ng: _guide)
+    return _guide.Coverage().Covered(t);
+}
+
+void PVR_HDHR::UpdateGuide()
+{
+    time_t now = time(nullptr);
+
+    // First remove stale entries
+    _age_out(now);
+
+    // Plan
+    std::vector<GuideRequest> requests;
     {
-        uint32_t number = ng.first;
-        auto&    guide = ng.second;
+        Lock guidelock(_guide_lock);
+        Lock pvrlock(_pvr_lock);
 
-        if (guide.Times().Contains(t))
+        if (_guide_schedule.BasicDue(now, _guide_contains(now)))
         {
-            return true;
+            GuideRequest request;
+            if (_plan_guide_request(request))
+                requests.push_back(request);
+        }
+        else if (g.Settings.extendedGuide)
+        {
+            _plan_extended_guide(now);
         }
     }
-    return false;
+
+    _run_guide_requests(requests);
 }
 
-void PVR_HDHR::UpdateGuide()
+// Queues the extended guide jobs, UpdateExtendedGuide fetches them.
+void PVR_HDHR::_plan_extended_guide(time_t now)
 {
-    // Offset by a random value to stagger load on the upstream servers.
-    static std::default_random_engine generator;
-    static std::uniform_int_distribution<int> distribution(0, g.Settings.guideRandom);
-    static time_t basic_update_time = 0;
+    // _guide_lock and _pvr_lock held
+    _guide_schedule.Begin();
 
-    time_t now = time(nullptr);
+    // No further than Kodi has asked for.  Nothing to plan while every
+    // channel with a guide covers the window.
+    time_t end = std::min(_guide_horizon(now), _guide_wanted);
+    bool   gap = _guide.Coverage().EarliestGap(now, end) < end;
 
-    // First remove stale entries
-    _age_out(now);
+    for (size_t i=0; gap && i<_guide.Size(); i++)
+    {
+        auto& guide = _guide.At(i);
 
-    Lock guidelock(_guide_lock);
+        if (guide.Times().Empty())
+        {
+            // Nothing retrieved for this channel with the basic guide, skip it.
+            continue;
+        }
 
-    bool do_basic = false;
+        time_t tail = guide.Times().End();
+        time_t want = std::min(end, guide.Wanted());
 
-    if (!_guide_contains(now))
-    {
-        do_basic = true;
-    }
-    int guide_early = g.Settings.guideBasicBeforeHour + distribution(generator);
-    if (now % g.Settings.guideBasicInterval >= g.Settings.guideBasicInterval - guide_early && now - basic_update_time > guide_early)
-    {
-        do_basic = true;
+        guide.RemoveRequest({0, now});
+        if (want > tail)
+        {
+            guide.AddRequest({tail, want});
+        }
+
+        _guide_schedule.Add(_guide.ID(i), guide.Requests(), now);
     }
-    if (basic_update_time + g.Settings.guideBasicInterval < now)
+}
+
+void PVR_HDHR::_plan_guide_jobs(const std::vector<GuideScheduler::Job>& jobs, std::vector<GuideRequest>& requests)
+{
+    // _guide_lock and _pvr_lock held
+    for (const auto& job : jobs)
     {
-        do_basic = true;
+        GuideRequest request;
+        request.number  = job.number;
+        request.start   = job.start;
+        request.recheck = true;
+        if (_plan_guide_request(request))
+            requests.push_back(request);
+        else
+            _guide_schedule.Done(job.number, job.start);
     }
-    if (do_basic)
-    {
-        _fetch_guide_data();
-        basic_update_time = now;
+}
+
+// One round of the queued extended guide jobs, as many as there are
+// workers, so the update thread is not held up for the whole pass.
+void PVR_HDHR::UpdateExtendedGuide()
+{
+    if (!g.Settings.extendedGuide)
         return;
+
+    std::vector<GuideRequest> requests;
+    {
+        Lock guidelock(_guide_lock);
+        Lock pvrlock(_pvr_lock);
+
+        _plan_guide_jobs(_guide_schedule.Dispatch(time(nullptr), g.Settings.guideWorkers), requests);
     }
 
-    if (g.Settings.extendedGuide)
+    _run_guide_requests(requests);
+}
+
+// Fetches the gaps in the windows Kodi asked for, on every tick of the
+// update thread.
+void PVR_HDHR::UpdateDemandedGuide()
+{
+    std::vector<GuideRequest> requests;
     {
-        for (auto& ng : _guide)
-        {
-            auto  number = ng.first;
-            auto& guide  = ng.second;
+        Lock guidelock(_guide_lock);
+        Lock pvrlock(_pvr_lock);
 
-            if (guide.Times().Empty())
-            {
-                // Nothing retrieved for this channel with the basic guide, skip it.
-                continue;
-            }
+        _plan_guide_jobs(_guide_schedule.DispatchDemand(g.Settings.guideWorkers), requests);
+    }
 
-            time_t tail = guide.Times().End();
-            time_t end  = now + g.Settings.guideDays*24*3600;
+    _run_guide_requests(requests);
+}
 
-            guide.RemoveRequest({0, now});
-            if (end > tail)
-            {
-                guide.AddRequest({tail, end});
-            }
+time_t PVR_HDHR::_guide_horizon(time_t now)
+{
+    // _pvr_lock held
+    int days = g.Settings.guideDays;
+    if (_epg_days > 0)
+        days = std::min(days, _epg_days);
+    return now + days*24*3600;
+}
 
-            if (guide.Requests().Empty())
-            {
-                continue;
-            }
+PVR_ERROR PVR_HDHR::SetEPGTimeFrame(int days)
+{
+    Lock pvrlock(_pvr_lock);
+    _epg_days = days;
+    return PVR_ERROR_NO_ERROR;
+}
 
-            // First try the last interval in requests
-            auto& last = guide.Requests().Last();
-            auto limit = g.Settings.guideExtendedHysteresis - distribution(generator);
-            if (last.Length() > limit)
-            {
-                _fetch_guide_data(&number, last.Start());
-            }
-            else if (guide.Requests().Count() > 1)
-            {
-                // Next attept to fill holes
-                // TODO - get iterator from IntervalSet
-                // Keep a separate set of start times.  Inserting into the guide modifies Requests.
-                std::set<time_t> starts;
-                for (const auto& i : guide.Requests().Intervals())
-                {
-                    auto start = i.Start();
-                    if (start == last.Start())
-                        break;
-                    starts.insert(start);
-                }
-                for (auto start : starts)
-                {
-                    if (!guide.Requests().Contains(start))
-                    {
-                        _fetch_guide_data(&number, start);
-                    }
-                }
-            }
+// Each worker fetches, parses and commits its own requests, so merging one
+// response overlaps with fetching the next.
+void PVR_HDHR::_run_guide_requests(const std::vector<GuideRequest>& requests)
+{
+    ParallelFor(requests.size(), g.Settings.guideWorkers,
+            [&](size_t i) {
+        _run_guide_request(requests[i]);
+        if (requests[i].recheck)
+        {
+            Lock guidelock(_guide_lock);
+            _guide_schedule.Done(requests[i].number, requests[i].start);
         }
-    }
+    });
 }
 
-int PVR_HDHR::GetChannelsAmount()
+void PVR_HDHR::_run_guide_request(const GuideRequest& request)
 {
-    return _lineup.size();
+    // The rest of the jobs are dropped at shutdown.
+    if (_stop.Stopped())
+        return;
+
+    if (request.recheck)
+    {
+        Lock guidelock(_guide_lock);
+        auto guide = _guide.Find(request.number);
+        if (!guide || !guide->Requests().Contains(request.start))
+            return;
+    }
+
+    for (int attempt = 0; ; attempt++)
+    {
+        if (!_guide_limiter.Wait(_stop))
+            return;
+
+        GuideParser parser;
+        auto result = _fetch_guide_data(request, parser);
+        if (result == GUIDE_FETCHED)
+        {
+            _insert_guide_data(parser.Channels());
+            return;
+        }
+        if (result == GUIDE_INVALID || attempt >= g.Settings.guideRetries)
+            return;
+
+        if (!_stop.SleepFor(std::chrono::seconds(g.Settings.guideRetryDelay << attempt)))
+            return;
+    }
 }
-PVR_ERROR PVR_HDHR::GetChannels(ADDON_HANDLE handle, bool radio)
+
+static const std::string FavoriteChannels = "Favorite channels";
+static const std::string HDChannels       = "HD channels";
+static const std::string SDChannels       = "SD channels";
+
+static const std::string* GroupNames[ChannelSnapshot::GROUP_COUNT] = {
+        &FavoriteChannels,
+        &HDChannels,
+        &SDChannels
+};
+
+void PVR_HDHR::_publish_channels()
 {
-    if (radio)
-        return PVR_ERROR_NO_ERROR;
+    // _pvr_lock held
+    std::shared_ptr<ChannelSnapshot> snapshot = std::make_shared<ChannelSnapshot>();
+    snapshot->channels.reserve(_lineup.Size());
 
-    Lock pvrlock(_pvr_lock);
-    for (auto& number: _lineup)
+    for (size_t i=0; i<_lineup.Size(); i++)
     {
+        static const Guide       noguide;
+        static const std::string empty{""};
+
+        GuideNumber number{_lineup.ID(i)};
+
+        auto channelguide  = _guide.Find(number);
+        const Guide& guide = channelguide ? *channelguide : noguide;
+
         PVR_CHANNEL pvrChannel = {0};
-        auto& guide = _guide[number];
-        auto& info  = _info[number];
 
         pvrChannel.iUniqueId         = number.ID();
         pvrChannel.iChannelNumber    = number._channel;
         pvrChannel.iSubChannelNumber = number._subchannel;
 
-        const std::string* name;
+        const std::string* name = nullptr;
         if (g.Settings.channelName == SettingsType::AFFILIATE) {
             name = &guide.Affiliate();
         }
@@ -654,16 +978,48 @@ PVR_ERROR PVR_HDHR::GetChannels(ADDON_HANDLE handle, bool radio)
         if (!name || !name->length() || (g.Settings.channelName == SettingsType::TUNER_NAME))
         {
             // Lineup name from device
-            name = &info._guidename;
+            name = &_lineup.Name(i);
         }
         if (!name)
         {
-            static const std::string empty{""};
             name = &empty;
         }
         pvr_strcpy(pvrChannel.strChannelName, *name);
         pvr_strcpy(pvrChannel.strIconPath, guide.ImageURL());
 
+        snapshot->channels.push_back(pvrChannel);
+
+        for (int group = 0; group < ChannelSnapshot::GROUP_COUNT; group++)
+        {
+            const auto& groupname = *GroupNames[group];
+            bool member = true;
+            if ((FavoriteChannels != groupname) && !_lineup.Has(i, ChannelTable::FAVORITE))
+                member = false;
+            if ((HDChannels != groupname) && !_lineup.Has(i, ChannelTable::HD))
+                member = false;
+            if ((SDChannels != groupname) && _lineup.Has(i, ChannelTable::HD))
+                member = false;
+            snapshot->members[group].push_back(member);
+        }
+    }
+
+    std::shared_ptr<const ChannelSnapshot> published = snapshot;
+    std::atomic_store(&_channels, published);
+}
+
+int PVR_HDHR::GetChannelsAmount()
+{
+    auto snapshot = std::atomic_load(&_channels);
+    return snapshot->channels.size();
+}
+PVR_ERROR PVR_HDHR::GetChannels(ADDON_HANDLE handle, bool radio)
+{
+    if (radio)
+        return PVR_ERROR_NO_ERROR;
+
+    auto snapshot = std::atomic_load(&_channels);
+    for (auto pvrChannel: snapshot->channels)
+    {
         g.PVR->TransferChannelEntry(handle, &pvrChannel);
     }
     return PVR_ERROR_NO_ERROR;
@@ -676,16 +1032,28 @@ PVR_ERROR PVR_HDHR::GetEPGForChannel(ADDON_HANDLE handle,
     Lock guidelock(_guide_lock);
     Lock pvrlock(_pvr_lock);
 
-    auto& guide = _guide[channel];
+    auto guide = _guide.Find(channel);
+    if (!guide)
+        return PVR_ERROR_NO_ERROR;
 
-    for (auto& ge: guide.Entries())
-    {
-        if (ge._endtime < start)
-            continue;
-        if (ge._starttime > end)
-            continue;
-        EPG_TAG tag = ge.Epg_Tag(channel);
+    guide->ForEachInWindow(start, end, channel, [&](EPG_TAG& tag) {
         g.PVR->TransferEpgEntry(handle, &tag);
+    });
+
+    // The guide is extended as far as Kodi shows it, and whatever is
+    // missing from this window is fetched first.
+    time_t now     = time(nullptr);
+    time_t horizon = _guide_horizon(now);
+    guide->Want(std::min(end, horizon));
+    _guide_wanted = std::max(_guide_wanted, guide->Wanted());
+
+    if (!guide->Times().Empty())
+    {
+        for (const auto& gap : guide->Times().Gaps({std::max(start, now), std::min(end, horizon)}))
+        {
+            guide->AddRequest(gap);
+            _guide_schedule.Demand(channel, gap);
+        }
     }
 
     return PVR_ERROR_NO_ERROR;
@@ -693,14 +1061,9 @@ PVR_ERROR PVR_HDHR::GetEPGForChannel(ADDON_HANDLE handle,
 
 int PVR_HDHR::GetChannelGroupsAmount()
 {
-    return 3;
+    return ChannelSnapshot::GROUP_COUNT;
 }
 
-static const std::string FavoriteChannels = "Favorite channels";
-static const std::string HDChannels       = "HD channels";
-static const std::string SDChannels       = "SD channels";
-
-
 PVR_ERROR PVR_HDHR::GetChannelGroups(ADDON_HANDLE handle, bool bRadio)
 {
     PVR_CHANNEL_GROUP channelGroup;
@@ -728,23 +1091,22 @@ PVR_ERROR PVR_HDHR::GetChannelGroups(ADDON_HANDLE handle, bool bRadio)
 PVR_ERROR PVR_HDHR::GetChannelGroupMembers(ADDON_HANDLE handle,
         const PVR_CHANNEL_GROUP &group)
 {
-    Lock pvrlock(_pvr_lock);
+    int index = 0;
+    while (index < ChannelSnapshot::GROUP_COUNT && *GroupNames[index] != group.strGroupName)
+        index ++;
+    if (index == ChannelSnapshot::GROUP_COUNT)
+        return PVR_ERROR_NO_ERROR;
 
-    for (const auto& number: _lineup)
+    auto  snapshot = std::atomic_load(&_channels);
+    auto& members  = snapshot->members[index];
+    for (size_t i = 0; i < snapshot->channels.size(); i++)
     {
-        auto& info  = _info[number];
-        auto& guide = _guide[number];
-
-        if ((FavoriteChannels != group.strGroupName) && !info._favorite)
-            continue;
-        if ((HDChannels != group.strGroupName) && !info._hd)
-            continue;
-        if ((SDChannels != group.strGroupName) && info._hd)
+        if (!members[i])
             continue;
 
         PVR_CHANNEL_GROUP_MEMBER channelGroupMember = {0};
         pvr_strcpy(channelGroupMember.strGroupName, group.strGroupName);
-        channelGroupMember.iChannelUniqueId = number.ID();
+        channelGroupMember.iChannelUniqueId = snapshot->channels[i].iUniqueId;
 
         g.PVR->TransferChannelGroupMember(handle, &channelGroupMember);
     }
@@ -882,7 +1244,7 @@ bool PVR_HDHR::OpenRecordedStream(const PVR_RECORDING& pvrrec)
         return false;
     }
 
-    const auto& ttl = rec->_title;
+    const auto& ttl = rec->_title.str();
     const auto& ep = rec->_episodetitle;
     std::cout << pvrrec.strRecordingId << " " << ttl << " " << ep << std::endl;
     std::cout << rec->_playurl << std::endl;
@@ -1235,21 +1597,23 @@ bool PVR_HDHR_TCP::_open_stream(const PVR_CHANNEL& channel)
     Lock strlock(_stream_lock);
 
     auto id = channel.iUniqueId;
-    const auto& entry = _lineup.find(id);
-    if (entry == _lineup.end())
+    auto i  = _lineup.Find(id);
+    if (i == ChannelTable::npos)
     {
         KODI_LOG(LOG_ERROR, "Channel %d not found!", id);
         return false;
     }
-    auto& info = _info[id];
+    const auto& guidenumber = _lineup.Number(i);
+    auto        devices     = _lineup.Devices(i);
 
-    if (g.Settings.recordforlive && _storage_devices.size())
+    if (g.Settings.recordforlive && _devices.Storage().size())
     {
-        for (auto device : _storage_devices)
+        for (const auto& storage : _devices.Storage())
         {
+            auto& device = storage.second;
             auto sessionid = ++ _sessionid;
             std::stringstream ss;
-            ss << device->BaseURL() << "/auto/v" + info._guidenumber;
+            ss << device->BaseURL() << "/auto/v" + guidenumber;
             ss << "?SessionID=0x" << std::hex << std::setw(8) << std::setfill('0') << sessionid;
             auto url = ss.str();
             if (_open_tcp_stream(url, true))
@@ -1259,20 +1623,25 @@ bool PVR_HDHR_TCP::_open_stream(const PVR_CHANNEL& channel)
                 return true;
             }
         }
-        KODI_LOG(LOG_INFO, "Failed to tune channel %s from storage, falling back to tuner device", info._guidenumber.c_str());
+        KODI_LOG(LOG_INFO, "Failed to tune channel %s from storage, falling back to tuner device", guidenumber.c_str());
     }
     std::cout << "Using direct tuning" << std::endl;
     _using_sd_record = false;
 
+    std::vector<unsigned> slots;
+    DeviceRegistry::ForEachSlot(devices, [&slots](unsigned slot) {
+        slots.push_back(slot);
+    });
+
     for (auto id : g.Settings.preferredDevice)
     {
-        for (auto device : info)
-            if (device->DeviceID() == id && _open_tcp_stream(info.DlnaURL(device), true))
+        for (auto slot : slots)
+            if (_devices.TunerAt(slot)->DeviceID() == id && _open_tcp_stream(_lineup.URL(i, slot), true))
                 return true;
     }
-    for (auto device : info)
+    for (auto slot : slots)
     {
-        if (_open_tcp_stream(info.DlnaURL(device), true))
+        if (_open_tcp_stream(_lineup.URL(i, slot), true))
             return true;
     }
 
@@ -31,24 +31,95 @@
 #include "Lockable.h"
 #include "IntervalSet.h"
 #include "Guide.h"
+#include "GuideParser.h"
+#include "GuideScheduler.h"
 #include "Utils.h"
-#include "Info.h"
+#include "ChannelTable.h"
 #include "Recording.h"
+#include "Discovery.h"
+#include "DeviceRegistry.h"
+#include "Snapshot.h"
+#include "WorkerPool.h"
 
 #define NO_FILE_CACHE 1
 
 namespace PVRHDHomeRun {
 
-class PVR_HDHR : public HasTunerSet<PVR_HDHR>
+// A lineup.json entry, parsed before the lineup is merged.
+struct LineupEntry
+{
+    LineupEntry(const Json::Value& v)
+        : number(v)
+        , flags((v["HD"].asBool()  ? ChannelTable::HD  : 0)
+              | (v["DRM"].asBool() ? ChannelTable::DRM : 0))
+        , url(v["URL"].asString())
+    {}
+
+    GuideNumber number;
+    uint8_t     flags;
+    std::string url;
+};
+
+// One guide.php request, planned under the locks and fetched without them.
+struct GuideRequest
+{
+    uint32_t    number  = 0;     // 0 for the basic guide of every channel
+    time_t      start   = 0;
+    bool        recheck = false; // Skipped if an earlier request filled it
+    std::string auth;
+    std::string ids;
+};
+
+enum GuideFetchResult
+{
+    GUIDE_FETCHED,
+    GUIDE_UNAVAILABLE, // Worth retrying
+    GUIDE_INVALID,
+};
+
+// Immutable view of the channel list for the Kodi query functions,
+// rebuilt and published as a whole whenever the lineup changes.
+struct ChannelSnapshot
+{
+    enum Group {
+        FAVORITE,
+        HD,
+        SD,
+        GROUP_COUNT
+    };
+
+    std::vector<PVR_CHANNEL> channels;
+    std::vector<bool>        members[GROUP_COUNT]; // Parallel to channels
+};
+
+class PVR_HDHR
 {
 public:
     PVR_HDHR() = default;
     virtual ~PVR_HDHR();
 
     bool DiscoverTunerDevices();
+    bool HandleDiscoveryEvents();
+    void StartDiscovery();
+    // Asks the discovery service for a broadcast, its events are picked up
+    // by the update thread.
+    void TriggerDiscovery()
+    {
+        _discovery.Trigger();
+    }
+    // Cuts short the guide requests in progress, before the add-on is
+    // destroyed.
+    void Stop()
+    {
+        _stop.Stop();
+    }
+    bool LoadSnapshot();
+    void SaveSnapshot();
     bool UpdateLineup();
     bool UpdateRecordings();
     void UpdateGuide();
+    void UpdateExtendedGuide();
+    void UpdateDemandedGuide();
     bool UpdateRules();
 
     bool Update()
@@ -60,7 +131,10 @@ public:
 
         return newDevice || newLineup || newRules;
     }
-    void AddLineupEntry(const Json::Value&, TunerDevice*);
+    // Returns true if the channel is new, or a visible field changed.
+    bool AddLineupEntry(const LineupEntry&, TunerDevice*, std::set<uint32_t>& seen);
+    // Reparse every lineup on the next update, after a settings change.
+    void InvalidateLineup();
 
     PVR_ERROR GetChannels(ADDON_HANDLE handle, bool bRadio);
     int       GetChannelsAmount();
@@ -115,7 +189,7 @@ public:
     void SetSpeed(int);
     bool IsTimeshifting(void);
 
-    PVR_ERROR SetEPGTimeFrame(int days) { return PVR_ERROR_NOT_IMPLEMENTED; }
+    PVR_ERROR SetEPGTimeFrame(int days);
     PVR_ERROR IsEPGTagPlayable(const EPG_TAG*, bool*) { return PVR_ERROR_NOT_IMPLEMENTED; }
     PVR_ERROR IsEPGTagRecordable(const EPG_TAG*, bool*) { return PVR_ERROR_NOT_IMPLEMENTED; }
     PVR_ERROR GetEPGTagStreamProperties(const EPG_TAG*, PVR_NAMED_VALUE*, unsigned int* count) { return PVR_ERROR_NOT_IMPLEMENTED; }
@@ -123,10 +197,20 @@ public:
     PVR_ERROR GetStreamReadChunkSize(int* chunksize) { return PVR_ERROR_NOT_IMPLEMENTED; }
 
 private:
+    bool  _apply_discovery_events(const std::vector<DiscoveryEvent>&);
+    bool  _load_snapshot(SnapshotReader&);
+    bool  _merge_lineup(TunerDevice*, const std::vector<LineupEntry>&);
+    void  _publish_channels();
     void  _age_out(time_t);
     bool  _guide_contains(time_t);
-    void  _insert_json_guide_data(const Json::Value&, const char* idstr);
-    void  _fetch_guide_data(const uint32_t* = nullptr, time_t start=0);
+    time_t _guide_horizon(time_t now);
+    bool  _plan_guide_request(GuideRequest&);
+    void  _plan_extended_guide(time_t now);
+    void  _plan_guide_jobs(const std::vector<GuideScheduler::Job>&, std::vector<GuideRequest>&);
+    void  _run_guide_requests(const std::vector<GuideRequest>&);
+    void  _run_guide_request(const GuideRequest&);
+    GuideFetchResult _fetch_guide_data(const GuideRequest&, GuideParser&);
+    void  _insert_guide_data(std::vector<GuideParser::Channel>&);
 
     virtual bool _open_stream(const PVR_CHANNEL& channel) { return false; };
     virtual bool _open_stream(const PVR_RECORDING& recording) { return false; };
@@ -138,12 +222,20 @@ protected:
     bool  _open_tcp_stream(const std::string&, bool live);
 
 protected:
-    std::set<uint32_t>        _device_ids;
-    std::set<std::string>     _storage_urls;
-    std::set<GuideNumber>     _lineup;
-    std::map<uint32_t, Info>  _info;
-    std::map<uint32_t, Guide> _guide;
+    DiscoveryService          _discovery;
+    ChannelTable              _lineup;
+    GuideTable                _guide;
+    std::map<uint32_t, size_t> _lineup_hash; // Device ID -> hash of lineup.json
+    uint64_t                  _lineup_generation = 0; // Incremented by InvalidateLineup
+    GuideScheduler            _guide_schedule;
+    int                       _epg_days     = 0; // From SetEPGTimeFrame, 0 if not set
+    time_t                    _guide_wanted = 0; // Latest time Kodi asked any guide for
+    // Read without locks, replaced with std::atomic_store under _pvr_lock
+    std::shared_ptr<const ChannelSnapshot> _channels = std::make_shared<ChannelSnapshot>();
     Recording                 _recording;
+    // All guide requests go to my.hdhomerun.com
+    RateLimiter               _guide_limiter{std::chrono::milliseconds(g.Settings.guideRequestInterval)};
+    StopSignal                _stop;
     uint32_t                  _sessionid = 0;
     size_t                    _filesize = 0;
 
@@ -158,9 +250,8 @@ protected:
 #endif
 
 public:
-    std::set<TunerDevice*>    _tuner_devices;
-    std::set<StorageDevice*>  _storage_devices;
-    StorageDevice*            _current_storage = nullptr;
+    DeviceRegistry            _devices;
+    DeviceRegistry::StorageHandle _current_storage;
     const Entry*              _current_entry   = nullptr;
     bool                      _live_stream = false;
 protected:
@@ -31,7 +31,7 @@ namespace PVRHDHomeRun
 {
 
 RecordingEntry::RecordingEntry(const Json::Value& v)
-: StringEntry(v)
+: Entry(v)
 {
     _category    = v["Category"].asString();
     _affiliate   = v["ChannelAffiliate"].asString();
@@ -59,7 +59,7 @@ PVR_RECORDING RecordingEntry::_pvr_recording() const
     x.iSeriesNumber = _season;
     x.iEpisodeNumber = _episode;
     pvr_strcpy(x.strPlot,        _synopsis);
-    pvr_strcpy(x.strChannelName, _channelnum + " " + _affiliate); // TODO - allow choice
+    pvr_strcpy(x.strChannelName, _channelnum.str() + " " + _affiliate.str()); // TODO - allow choice
     pvr_strcpy(x.strIconPath,    _imageURL); // _channelimg
     pvr_strcpy(x.strDirectory,   _grouptitle);
     x.recordingTime = _starttime;
@@ -91,6 +91,41 @@ void RecordingEntry::Resume(int i)
     GetFileContents(url.str(), result);
 }
 
+void RecordingEntry::Save(SnapshotWriter& w) const
+{
+    Entry::Save(w);
+    w.Put(_category);
+    w.Put(_affiliate);
+    w.Put(_channelimg);
+    w.Put(_channelname);
+    w.Put(_channelnum);
+    w.Put(_programID);
+    w.Put(_groupID);
+    w.Put(_grouptitle);
+    w.Put(_playurl);
+    w.Put(_cmdurl);
+    w.Put(_resume);
+    w.PutTime(_recordstarttime);
+    w.PutTime(_recordendtime);
+}
+bool RecordingEntry::Load(SnapshotReader& r)
+{
+    return Entry::Load(r)
+            && r.Get(_category)
+            && r.Get(_affiliate)
+            && r.Get(_channelimg)
+            && r.Get(_channelname)
+            && r.Get(_channelnum)
+            && r.Get(_programID)
+            && r.Get(_groupID)
+            && r.Get(_grouptitle)
+            && r.Get(_playurl)
+            && r.Get(_cmdurl)
+            && r.Get(_resume)
+            && r.GetTime(_recordstarttime)
+            && r.GetTime(_recordendtime);
+}
+
 bool operator==(const RecordingEntry& a, const RecordingEntry& b)
 {
     return static_cast<const Entry&>(a) == static_cast<const Entry&>(b) &&
@@ -171,8 +206,52 @@ RecordingEntry* Recording::getEntry(const std::string& id)
     return &rec;
 }
 
+void Recording::Save(SnapshotWriter& w) const
+{
+    w.Put(static_cast<uint32_t>(_records.size()));
+    for (const auto& r : _records)
+    {
+        r.second.Save(w);
+    }
+    w.Put(static_cast<uint32_t>(_rules.size()));
+    for (const auto& r : _rules)
+    {
+        r.second.Save(w);
+    }
+}
+
+bool Recording::Load(SnapshotReader& r)
+{
+    _records.clear();
+    _rules.clear();
+
+    uint32_t count;
+    if (!r.Count(count))
+        return false;
+    for (uint32_t n=0; n<count; n++)
+    {
+        RecordingEntry entry;
+        if (!entry.Load(r))
+            return false;
+        auto id = entry.ID();
+        _records.emplace(std::move(id), std::move(entry));
+    }
+
+    if (!r.Count(count))
+        return false;
+    for (uint32_t n=0; n<count; n++)
+    {
+        RecordingRule rule;
+        if (!rule.Load(r))
+            return false;
+        auto id = rule.ID();
+        _rules.emplace(std::move(id), std::move(rule));
+    }
+    return true;
+}
+
 RecordingRule::RecordingRule(const Json::Value& v)
-: StringEntry(v)
+: Entry(v)
 {
     _recordingruleID = v["RecordingRuleID"].asString();
     _datetimeonly    = v["DateTimeOnly"].asUInt64();
@@ -181,4 +260,25 @@ RecordingRule::RecordingRule(const Json::Value& v)
     _endpadding      = v["EndPadding"].asInt();
 }
 
+void RecordingRule::Save(SnapshotWriter& w) const
+{
+    Entry::Save(w);
+    w.Put(_recordingruleID);
+    w.PutTime(_datetimeonly);
+    w.Put(_channelonly);
+    w.Put(static_cast<int32_t>(_startpadding));
+    w.Put(static_cast<int32_t>(_endpadding));
+}
+bool RecordingRule::Load(SnapshotReader& r)
+{
+    int32_t startpadding, endpadding;
+    if (!(Entry::Load(r) && r.Get(_recordingruleID) && r.GetTime(_datetimeonly)
+            && r.Get(_channelonly) && r.Get(startpadding) && r.Get(endpadding)))
+        return false;
+
+    _startpadding = startpadding;
+    _endpadding   = endpadding;
+    return true;
+}
+
 } // namespace PVRHDHomeRun
@@ -33,38 +33,32 @@ namespace PVRHDHomeRun
 
 class StorageDevice;
 
-class StringEntry : public Entry
-{
-public:
-    StringEntry(const Json::Value& v) : Entry(v) {};
-    virtual ~StringEntry() = default;
-    virtual const std::string& ID() const = 0;
-};
-
-class RecordingEntry : public StringEntry
+class RecordingEntry : public Entry
 {
 public:
     RecordingEntry(const Json::Value&);
-
-    std::string _category;
-    std::string _affiliate;
-    std::string _channelimg;
-    std::string _channelname;
-    std::string _channelnum;
-    std::string _programID;
-    std::string _groupID;
-    std::string _grouptitle;
+    RecordingEntry() = default;
+
+    PooledString _category;
+    PooledString _affiliate;
+    PooledString _channelimg;
+    PooledString _channelname;
+    PooledString _channelnum;
+    std::string  _programID;
+    PooledString _groupID;
+    PooledString _grouptitle;
     std::string _playurl;
     std::string _cmdurl;
     int64_t     _resume = 0;
 
-    time_t _recordstarttime;
-    time_t _recordendtime;
+    time_t _recordstarttime = 0;
+    time_t _recordendtime   = 0;
 
-    time_t StartTime() const override;
-    time_t EndTime() const override;
+    // The recorded times, rather than the broadcast times.
+    time_t StartTime() const;
+    time_t EndTime() const;
 
-    const std::string& ID() const override
+    const std::string& ID() const
     {
         return _programID;
     }
@@ -73,6 +67,9 @@ public:
     {
         return _pvr_recording();
     }
+
+    void Save(SnapshotWriter&) const;
+    bool Load(SnapshotReader&);
     void Resume(int);
     int Resume() const
     {
@@ -88,10 +85,11 @@ private:
 bool operator<(const RecordingEntry&, const RecordingEntry&);
 bool operator==(const RecordingEntry&, const RecordingEntry&);
 
-class RecordingRule : public StringEntry
+class RecordingRule : public Entry
 {
 public:
     RecordingRule(const Json::Value& json);
+    RecordingRule() = default;
     std::string _recordingruleID;
 
     time_t      _datetimeonly = 0;
@@ -99,10 +97,13 @@ public:
     int         _startpadding = 0;
     int         _endpadding   = 0;
 
-    const std::string& ID() const override
+    const std::string& ID() const
     {
         return _recordingruleID;
     }
+
+    void Save(SnapshotWriter&) const;
+    bool Load(SnapshotReader&);
 };
 
 bool operator<(const RecordingRule&, const RecordingRule&);
@@ -175,6 +176,9 @@ public:
 
     const std::map<std::string, RecordingEntry>& Records() const { return _records; };
     RecordingEntry* getEntry(const std::string&);
+
+    void Save(SnapshotWriter&) const;
+    bool Load(SnapshotReader&);
 };
 
 } // namespace PVRHDHomeRun
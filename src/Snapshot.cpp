@@ -0,0 +1,301 @@
+/*
+ *      Copyright (C) 2017-2019 Matthew Lundberg <matthew.k.lundberg@gmail.com>
+ *      https://github.com/MatthewLundberg/pvr.hdhomerun
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include "Snapshot.h"
+#include "Addon.h"
+#include "StringPool.h"
+#include "Utils.h"
+
+#include <cstdio>
+#include <cstring>
+
+namespace PVRHDHomeRun
+{
+
+namespace
+{
+const char Magic[8] = {'H','D','H','R','S','N','A','P'};
+
+// FNV-1a, to reject truncated or damaged files.
+uint64_t checksum(const std::string& data)
+{
+    uint64_t h = 14695981039346656037ULL;
+    for (unsigned char c : data)
+    {
+        h ^= c;
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+template<typename T>
+void put_le(std::string& out, T v)
+{
+    for (size_t i=0; i<sizeof(T); i++)
+    {
+        out.push_back(static_cast<char>(static_cast<uint64_t>(v) >> (8*i)));
+    }
+}
+
+template<typename T>
+T get_le(const char* p)
+{
+    uint64_t v = 0;
+    for (size_t i=0; i<sizeof(T); i++)
+    {
+        v |= static_cast<uint64_t>(static_cast<unsigned char>(p[i])) << (8*i);
+    }
+    return static_cast<T>(v);
+}
+}
+
+void SnapshotWriter::Put(bool v)
+{
+    _data.push_back(v ? 1 : 0);
+}
+void SnapshotWriter::Put(uint8_t v)
+{
+    _data.push_back(static_cast<char>(v));
+}
+void SnapshotWriter::Put(uint32_t v)
+{
+    put_le(_data, v);
+}
+void SnapshotWriter::Put(int32_t v)
+{
+    put_le(_data, static_cast<uint32_t>(v));
+}
+void SnapshotWriter::Put(uint64_t v)
+{
+    put_le(_data, v);
+}
+void SnapshotWriter::Put(int64_t v)
+{
+    put_le(_data, static_cast<uint64_t>(v));
+}
+void SnapshotWriter::Put(const std::string& s)
+{
+    Put(static_cast<uint32_t>(s.size()));
+    _data.append(s);
+}
+void SnapshotWriter::Put(const char* p, size_t n)
+{
+    _data.append(p, n);
+}
+
+bool SnapshotReader::_take(size_t n, const char*& p)
+{
+    if (!_ok || _data.size() - _pos < n)
+    {
+        _ok = false;
+        return false;
+    }
+    p = _data.data() + _pos;
+    _pos += n;
+    return true;
+}
+
+bool SnapshotReader::Get(bool& v)
+{
+    const char* p;
+    if (!_take(1, p))
+        return false;
+    v = *p != 0;
+    return true;
+}
+bool SnapshotReader::Get(uint8_t& v)
+{
+    const char* p;
+    if (!_take(1, p))
+        return false;
+    v = static_cast<uint8_t>(*p);
+    return true;
+}
+bool SnapshotReader::Get(uint32_t& v)
+{
+    const char* p;
+    if (!_take(sizeof(v), p))
+        return false;
+    v = get_le<uint32_t>(p);
+    return true;
+}
+bool SnapshotReader::Get(int32_t& v)
+{
+    uint32_t u;
+    if (!Get(u))
+        return false;
+    v = static_cast<int32_t>(u);
+    return true;
+}
+bool SnapshotReader::Get(uint64_t& v)
+{
+    const char* p;
+    if (!_take(sizeof(v), p))
+        return false;
+    v = get_le<uint64_t>(p);
+    return true;
+}
+bool SnapshotReader::Get(int64_t& v)
+{
+    uint64_t u;
+    if (!Get(u))
+        return false;
+    v = static_cast<int64_t>(u);
+    return true;
+}
+bool SnapshotReader::Get(std::string& s)
+{
+    uint32_t n;
+    const char* p;
+    if (!Get(n) || !_take(n, p))
+        return false;
+    s.assign(p, n);
+    return true;
+}
+bool SnapshotReader::Get(PooledString& s)
+{
+    std::string v;
+    if (!Get(v))
+        return false;
+    s = v;
+    return true;
+}
+bool SnapshotReader::Get(char* out, size_t n)
+{
+    const char* p;
+    if (!_take(n, p))
+        return false;
+    memcpy(out, p, n);
+    return true;
+}
+
+bool SnapshotReader::Count(uint32_t& n)
+{
+    if (!Get(n))
+        return false;
+    // Every element takes at least one byte.
+    if (n > _data.size() - _pos)
+    {
+        _ok = false;
+        return false;
+    }
+    return true;
+}
+
+std::string SnapshotHeader(const std::string& payload)
+{
+    std::string header(Magic, sizeof(Magic));
+    put_le(header, SnapshotWriter::Version);
+    put_le(header, static_cast<uint64_t>(payload.size()));
+    put_le(header, checksum(payload));
+    return header;
+}
+
+// Written beside the old file and renamed over it, so that a crash while
+// saving leaves the previous snapshot in place.
+bool WriteSnapshotFile(const std::string& path, const SnapshotWriter& writer)
+{
+    const auto& payload = writer.Data();
+    auto        header  = SnapshotHeader(payload);
+
+    auto tmp = path + ".tmp";
+    void* fileHandle = g.XBMC->OpenFileForWrite(tmp.c_str(), true);
+    if (fileHandle == nullptr)
+    {
+        KODI_LOG(LOG_ERROR, "Cannot open %s for writing", tmp.c_str());
+        return false;
+    }
+
+    bool ok = g.XBMC->WriteFile(fileHandle, header.data(), header.size()) == static_cast<ssize_t>(header.size())
+           && g.XBMC->WriteFile(fileHandle, payload.data(), payload.size()) == static_cast<ssize_t>(payload.size());
+    if (ok)
+        g.XBMC->FlushFile(fileHandle);
+    g.XBMC->CloseFile(fileHandle);
+
+    if (!ok)
+    {
+        KODI_LOG(LOG_ERROR, "Error writing %s", tmp.c_str());
+        g.XBMC->DeleteFile(tmp.c_str());
+        return false;
+    }
+
+    // Kodi's VFS has no rename, the user path is a local directory.
+#ifdef TARGET_WINDOWS
+    ok = MoveFileExA(tmp.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    ok = rename(tmp.c_str(), path.c_str()) == 0;
+#endif
+    if (!ok)
+    {
+        KODI_LOG(LOG_ERROR, "Cannot replace %s", path.c_str());
+        g.XBMC->DeleteFile(tmp.c_str());
+    }
+    return ok;
+}
+
+bool ReadSnapshotFile(const std::string& path, std::string& payload)
+{
+    if (!g.XBMC->FileExists(path.c_str(), false))
+        return false;
+
+    std::string contents;
+    if (!GetFileContents(path, contents))
+        return false;
+
+    return UnpackSnapshot(path, contents, payload);
+}
+
+bool UnpackSnapshot(const std::string& path, const std::string& contents, std::string& payload)
+{
+    const size_t header_size = sizeof(Magic) + sizeof(uint32_t) + 2*sizeof(uint64_t);
+    if (contents.size() < header_size || memcmp(contents.data(), Magic, sizeof(Magic)))
+    {
+        KODI_LOG(LOG_INFO, "Ignoring invalid snapshot %s", path.c_str());
+        return false;
+    }
+
+    const char* p = contents.data() + sizeof(Magic);
+    auto version  = get_le<uint32_t>(p);
+    auto size     = get_le<uint64_t>(p + sizeof(uint32_t));
+    auto sum      = get_le<uint64_t>(p + sizeof(uint32_t) + sizeof(uint64_t));
+
+    if (version != SnapshotWriter::Version)
+    {
+        KODI_LOG(LOG_INFO, "Ignoring snapshot %s with version %u", path.c_str(), version);
+        return false;
+    }
+    if (size != contents.size() - header_size)
+    {
+        KODI_LOG(LOG_INFO, "Ignoring truncated snapshot %s", path.c_str());
+        return false;
+    }
+
+    payload = contents.substr(header_size);
+    if (checksum(payload) != sum)
+    {
+        KODI_LOG(LOG_INFO, "Ignoring damaged snapshot %s", path.c_str());
+        payload.clear();
+        return false;
+    }
+    return true;
+}
+
+} // namespace PVRHDHomeRun
@@ -0,0 +1,121 @@
+#pragma once
+/*
+ *      Copyright (C) 2017-2019 Matthew Lundberg <matthew.k.lundberg@gmail.com>
+ *      https://github.com/MatthewLundberg/pvr.hdhomerun
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <cstdint>
+#include <ctime>
+#include <string>
+
+namespace PVRHDHomeRun
+{
+
+class PooledString;
+
+// Compact little-endian binary encoding of the add-on state, written to
+// the user data directory so that ADDON_Create can serve the previous
+// session's devices, lineup, guide and recordings immediately.
+//
+// Bump Version whenever the layout of any saved object changes.
+class SnapshotWriter
+{
+public:
+    static const uint32_t Version = 4;
+
+    void Put(bool);
+    void Put(uint8_t);
+    void Put(uint32_t);
+    void Put(int32_t);
+    void Put(uint64_t);
+    void Put(int64_t);
+    void Put(const std::string&);
+    void Put(const char*, size_t);
+
+    // Time values are always stored as 64 bits.
+    void PutTime(time_t t)
+    {
+        Put(static_cast<int64_t>(t));
+    }
+
+    const std::string& Data() const
+    {
+        return _data;
+    }
+
+private:
+    std::string _data;
+};
+
+// Every Get() returns false, and leaves the reader failed, on underflow.
+class SnapshotReader
+{
+public:
+    SnapshotReader(const std::string& data)
+        : _data(data)
+    {}
+
+    bool Get(bool&);
+    bool Get(uint8_t&);
+    bool Get(uint32_t&);
+    bool Get(int32_t&);
+    bool Get(uint64_t&);
+    bool Get(int64_t&);
+    bool Get(std::string&);
+    bool Get(PooledString&);
+    bool Get(char*, size_t);
+
+    bool GetTime(time_t& t)
+    {
+        int64_t v;
+        if (!Get(v))
+            return false;
+        t = static_cast<time_t>(v);
+        return true;
+    }
+
+    // Sanity check for an element count about to be read.
+    bool Count(uint32_t& n);
+
+    bool Ok() const
+    {
+        return _ok;
+    }
+    bool AtEnd() const
+    {
+        return _pos == _data.size();
+    }
+
+private:
+    bool _take(size_t n, const char*& p);
+
+    const std::string& _data;
+    size_t             _pos = 0;
+    bool               _ok  = true;
+};
+
+bool WriteSnapshotFile(const std::string& path, const SnapshotWriter&);
+bool ReadSnapshotFile(const std::string& path, std::string& payload);
+
+// The file is the header followed by the payload.  Unpack checks the header
+// and returns the payload, the path is for the log.
+std::string SnapshotHeader(const std::string& payload);
+bool        UnpackSnapshot(const std::string& path, const std::string& contents, std::string& payload);
+
+} // namespace PVRHDHomeRun
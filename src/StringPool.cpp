@@ -0,0 +1,106 @@
+/*
+ *      Copyright (C) 2017-2019 Matthew Lundberg <matthew.k.lundberg@gmail.com>
+ *      https://github.com/MatthewLundberg/pvr.hdhomerun
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include "StringPool.h"
+#include "Lockable.h"
+
+#include <unordered_map>
+
+namespace PVRHDHomeRun
+{
+
+const std::string PooledString::_empty;
+
+namespace
+{
+// Each handle points at its map key, so a string is stored once.  The map
+// holds weak references; the handle's deleter removes the key unless the
+// string was interned again after the last handle went away.
+class Pool : public Lockable
+{
+public:
+    StringPool::Handle Intern(const std::string& s)
+    {
+        Lock lock(this);
+
+        auto it = _strings.find(s);
+        if (it == _strings.end())
+        {
+            it = _strings.emplace(s, std::weak_ptr<const std::string>()).first;
+        }
+
+        auto h = it->second.lock();
+        if (!h)
+        {
+            h = StringPool::Handle(&it->first, [this](const std::string* p) { _release(p); });
+            it->second = h;
+        }
+        return h;
+    }
+
+    StringPool::Stats GetStats()
+    {
+        Lock lock(this);
+
+        StringPool::Stats stats = {_strings.size(), 0};
+        for (auto& s : _strings)
+        {
+            stats.bytes += s.first.capacity();
+        }
+        return stats;
+    }
+
+private:
+    void _release(const std::string* p)
+    {
+        Lock lock(this);
+
+        auto it = _strings.find(*p);
+        if (it != _strings.end() && &it->first == p && it->second.expired())
+        {
+            _strings.erase(it);
+        }
+    }
+
+    std::unordered_map<std::string, std::weak_ptr<const std::string>> _strings;
+};
+
+// Never destroyed, handles may outlive static destruction.
+Pool& pool()
+{
+    static Pool* p = new Pool;
+    return *p;
+}
+}
+
+StringPool::Handle StringPool::Intern(const std::string& s)
+{
+    if (s.empty())
+        return nullptr;
+    return pool().Intern(s);
+}
+
+StringPool::Stats StringPool::GetStats()
+{
+    return pool().GetStats();
+}
+
+} // namespace PVRHDHomeRun
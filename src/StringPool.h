@@ -0,0 +1,101 @@
+#pragma once
+/*
+ *      Copyright (C) 2017-2019 Matthew Lundberg <matthew.k.lundberg@gmail.com>
+ *      https://github.com/MatthewLundberg/pvr.hdhomerun
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace PVRHDHomeRun
+{
+
+// Process-wide pool of immutable strings.  Series titles, image URLs and
+// channel names repeat thousands of times across the guide and the
+// recordings, so entries hold a reference counted handle to one shared
+// copy.  A string leaves the pool when its last handle is released.
+class StringPool
+{
+public:
+    typedef std::shared_ptr<const std::string> Handle;
+
+    // Empty strings are not pooled, they return a null handle.
+    static Handle Intern(const std::string&);
+
+    struct Stats
+    {
+        size_t strings;
+        size_t bytes;
+    };
+    static Stats GetStats();
+};
+
+// A pooled string.  Equal strings share one handle, so comparison is a
+// pointer comparison.
+class PooledString
+{
+public:
+    PooledString() = default;
+    PooledString(const std::string& s)
+        : _h(StringPool::Intern(s))
+    {}
+    PooledString& operator=(const std::string& s)
+    {
+        _h = StringPool::Intern(s);
+        return *this;
+    }
+
+    const std::string& str() const
+    {
+        return _h ? *_h : _empty;
+    }
+    operator const std::string&() const
+    {
+        return str();
+    }
+    const char* c_str() const
+    {
+        return str().c_str();
+    }
+    bool empty() const
+    {
+        return !_h;
+    }
+    size_t size() const
+    {
+        return str().size();
+    }
+
+    friend bool operator==(const PooledString& a, const PooledString& b)
+    {
+        return a._h == b._h;
+    }
+    friend bool operator!=(const PooledString& a, const PooledString& b)
+    {
+        return a._h != b._h;
+    }
+
+private:
+    static const std::string _empty;
+    StringPool::Handle _h;
+};
+
+} // namespace PVRHDHomeRun
@@ -21,11 +21,14 @@
  */
 
 #include "Lockable.h"
-#include <set>
+#include <algorithm>
+#include <vector>
 
 namespace PVRHDHomeRun
 {
 
+// The values in use, kept as a sorted vector.  A value is handed out as
+// asked for when it is free, otherwise the next free value after it is used.
 template<typename T>
 class UniqueID : public Lockable
 {
@@ -35,41 +38,48 @@ public:
     UniqueID(const UniqueID&) = delete;
     UniqueID& operator=(const UniqueID&) = delete;
 
-    T acquire()
+    // Never returns 0.
+    T acquire(T preferred)
     {
         Lock lock(this);
 
-        if (_free.size())
+        T value = preferred ? preferred : 1;
+        auto it = std::lower_bound(_used.begin(), _used.end(), value);
+        while (it != _used.end() && *it == value)
         {
-            auto it = _free.begin();
-            auto value = *it;
-            _free.erase(it);
-            return value;
+            it ++;
+            value ++;
+            if (value == 0)
+            {
+                value = 1;
+                it = std::lower_bound(_used.begin(), _used.end(), value);
+            }
         }
-        auto value = _next;
-        _next ++;
+        _used.insert(it, value);
         return value;
     }
 
-    void release(T value)
+    // Mark a value previously handed out as in use, when restoring saved state.
+    void reserve(T value)
     {
         Lock lock(this);
 
-        _free.insert(value);
+        auto it = std::lower_bound(_used.begin(), _used.end(), value);
+        if (it == _used.end() || *it != value)
+            _used.insert(it, value);
+    }
 
-        while (_free.size())
-        {
-            value = *_free.rbegin();
-            if (value < (_next - 1))
-                break;
-            _free.erase(value);
-            _next --;
-        }
+    void release(T value)
+    {
+        Lock lock(this);
+
+        auto it = std::lower_bound(_used.begin(), _used.end(), value);
+        if (it != _used.end() && *it == value)
+            _used.erase(it);
     }
 
 private:
-    std::set<T> _free;
-    T           _next = 0;
+    std::vector<T> _used;
 };
 
 }
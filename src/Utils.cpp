@@ -26,6 +26,7 @@
  */
 
 #include "Utils.h"
+#include "HttpClient.h"
 
 #include <string>
 #include <memory>
@@ -62,35 +63,28 @@ namespace PVRHDHomeRun
 
 bool GetFileContents(const std::string& url, std::string& strContent)
 {
-    char buffer[1024];
-    void* fileHandle;
-
-    strContent.clear();
-    fileHandle = g.XBMC->OpenFile(url.c_str(), 0);
-
-    if (fileHandle == nullptr)
-    {
-        KODI_LOG(0, "GetFileContents: %s failed\n", url.c_str());
-        return false;
-    }
-
-    for (;;)
-    {
-        int bytesRead = g.XBMC->ReadFile(fileHandle, buffer, sizeof(buffer));
-        if (bytesRead <= 0)
-            break;
-        strContent.append(buffer, bytesRead);
-    }
+    return DefaultHttpClient().Get(url, strContent, 0);
+}
 
-    g.XBMC->CloseFile(fileHandle);
+bool StreamFileContents(const std::string& url, const std::function<bool(const char*, size_t)>& sink)
+{
+    return DefaultHttpClient().Stream(url, sink, 0);
+}
 
-    return true;
+bool GetFileContents(const std::string& url, std::string& strContent, int timeout)
+{
+    return DefaultHttpClient().Get(url, strContent, timeout);
 }
 
 bool StringToJson(const std::string& in, Json::Value& out, std::string& err)
 {
-    Json::CharReaderBuilder builder;
-    std::unique_ptr<Json::CharReader> const reader(builder.newCharReader());
+    // Reused by every call on the same thread.
+    thread_local std::unique_ptr<Json::CharReader> reader;
+    if (!reader)
+    {
+        Json::CharReaderBuilder builder;
+        reader.reset(builder.newCharReader());
+    }
     return reader->parse(in.c_str(), in.c_str() + in.size(), &out, &err);
 }
 
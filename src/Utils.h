@@ -26,6 +26,7 @@
  *
  */
 
+#include <functional>
 #include <string>
 #include <json/json.h>
 
@@ -68,6 +69,9 @@ void pvr_strcpy(char (&dest)[N], const char* src)
 }
 
 bool GetFileContents(const std::string& url, std::string& content);
+bool GetFileContents(const std::string& url, std::string& content, int timeout);
+// Passes the contents to sink as they are read, stopping if it returns false.
+bool StreamFileContents(const std::string& url, const std::function<bool(const char*, size_t)>& sink);
 bool StringToJson(const std::string& in, Json::Value& out, std::string& err);
 
 std::string EncodeURL(const std::string& strUrl);
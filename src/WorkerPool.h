@@ -0,0 +1,242 @@
+#pragma once
+/*
+ *      Copyright (C) 2017-2019 Matthew Lundberg <matthew.k.lundberg@gmail.com>
+ *      https://github.com/MatthewLundberg/pvr.hdhomerun
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include "Lockable.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+
+namespace PVRHDHomeRun
+{
+
+// Threads kept for ParallelFor, so that what they keep per thread, such as
+// the read buffer in HttpClient and the JSON reader in Utils, is reused by
+// the next batch.  Grows to the most tasks ever run at once.
+class WorkerPool
+{
+public:
+    static WorkerPool& Shared()
+    {
+        static WorkerPool pool;
+        return pool;
+    }
+
+    WorkerPool() = default;
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+    ~WorkerPool()
+    {
+        Stop();
+    }
+
+    // Runs work on n threads.  Each starts at once, a thread is added if
+    // none is idle, so tasks may wait for each other.  done runs after each
+    // work, once its thread counts as idle, so that a Post made when the
+    // last one is done reuses the threads.
+    void Post(size_t n, const std::function<void()>& work, const std::function<void()>& done)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        for (size_t i=0; i<n; i++)
+        {
+            _tasks.push_back({work, done});
+        }
+        while (_idle < _tasks.size())
+        {
+            _threads.emplace_back(&WorkerPool::_run, this);
+            _idle ++;
+        }
+        _wake.notify_all();
+    }
+
+    // Joins the threads once their tasks are done.  Called when the add-on
+    // is destroyed, a DLL must not join threads while it is unloaded.
+    void Stop()
+    {
+        std::vector<std::thread> threads;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stopping = true;
+            threads.swap(_threads);
+        }
+        _wake.notify_all();
+        for (auto& t : threads)
+        {
+            t.join();
+        }
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopping = false;
+        _idle     = 0;
+    }
+
+private:
+    void _run()
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        for (;;)
+        {
+            _wake.wait(lock, [this]() { return _stopping || !_tasks.empty(); });
+            if (_tasks.empty())
+                return;
+
+            auto task = std::move(_tasks.front());
+            _tasks.pop_front();
+            _idle --;
+
+            lock.unlock();
+            task.work();
+            lock.lock();
+            _idle ++;
+
+            lock.unlock();
+            task.done();
+            lock.lock();
+        }
+    }
+
+    struct Task
+    {
+        std::function<void()> work;
+        std::function<void()> done;
+    };
+
+    std::mutex                        _mutex;
+    std::condition_variable           _wake;
+    std::deque<Task>                  _tasks;
+    std::vector<std::thread>          _threads;
+    size_t                            _idle     = 0;
+    bool                              _stopping = false;
+};
+
+// Call f(i) for every i in [0, count), using at most 'workers' threads, the
+// caller's and those of the shared WorkerPool.  Returns once every call has
+// completed.  f must not throw.
+template<typename F>
+void ParallelFor(size_t count, size_t workers, F f)
+{
+    workers = std::min(workers, count);
+    if (workers <= 1)
+    {
+        for (size_t i=0; i<count; i++)
+        {
+            f(i);
+        }
+        return;
+    }
+
+    std::atomic<size_t> next{0};
+    auto run = [&]()
+    {
+        for (;;)
+        {
+            size_t i = next++;
+            if (i >= count)
+                break;
+            f(i);
+        }
+    };
+
+    std::mutex              mutex;
+    std::condition_variable finished;
+    size_t                  helpers = workers - 1;
+    WorkerPool::Shared().Post(helpers, run, [&]()
+    {
+        // Notified under the lock, the caller returns only once it is released.
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--helpers == 0)
+            finished.notify_one();
+    });
+    run();
+
+    std::unique_lock<std::mutex> lock(mutex);
+    finished.wait(lock, [&]() { return helpers == 0; });
+}
+
+// Set once at shutdown, ending the sleeps of every thread waiting on it.
+class StopSignal
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    void Stop()
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopped = true;
+        _wake.notify_all();
+    }
+    bool Stopped() const
+    {
+        return _stopped;
+    }
+    // Returns false if stopped before t.
+    bool SleepUntil(Clock::time_point t)
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        return !_wake.wait_until(lock, t, [this]() { return _stopped.load(); });
+    }
+    bool SleepFor(Clock::duration d)
+    {
+        return SleepUntil(Clock::now() + d);
+    }
+
+private:
+    std::mutex              _mutex;
+    std::condition_variable _wake;
+    std::atomic<bool>       _stopped{false};
+};
+
+// Spaces the returns from Wait() at least 'interval' apart, across all
+// threads calling it.
+class RateLimiter : public Lockable
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    RateLimiter(std::chrono::milliseconds interval)
+        : _interval(interval)
+    {}
+
+    // Returns false, at once, if stop is signalled while waiting.
+    bool Wait(StopSignal& stop)
+    {
+        Clock::time_point slot;
+        {
+            Lock lock(this);
+            slot  = std::max(Clock::now(), _next);
+            _next = slot + _interval;
+        }
+        return stop.SleepUntil(slot);
+    }
+
+private:
+    std::chrono::milliseconds _interval;
+    Clock::time_point         _next;
+};
+
+} // namespace PVRHDHomeRun
@@ -0,0 +1,67 @@
+/*
+ *      Copyright (C) 2017-2019 Matthew Lundberg <matthew.k.lundberg@gmail.com>
+ *      https://github.com/MatthewLundberg/pvr.hdhomerun
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+
+#include "Entry.h"
+#include "Test.h"
+
+using namespace PVRHDHomeRun;
+
+namespace
+{
+
+Json::Value Programme(bool rule, const char* series)
+{
+    Json::Value v;
+    v["StartTime"] = 1546300800;
+    v["EndTime"]   = 1546302600;
+    v["Title"]     = "News";
+    if (series)
+        v["SeriesID"] = series;
+    if (rule)
+        v["RecordingRule"] = 1;
+    return v;
+}
+
+// The broadcast ID must survive a recording rule being added or removed.
+void PreferredID()
+{
+    for (auto series : {static_cast<const char*>(nullptr), "EP012345"})
+    {
+        Entry plain(Programme(false, series));
+        Entry ruled(Programme(true, series));
+        CHECK(plain._title.str() == "News");
+        CHECK(ruled._title.str() == "* News");
+        CHECK(plain.PreferredID() == ruled.PreferredID());
+    }
+
+    Entry title(Programme(false, nullptr));
+    Entry series(Programme(false, "EP012345"));
+    CHECK(title.PreferredID() != series.PreferredID());
+}
+
+} // namespace
+
+int main()
+{
+    PreferredID();
+    return Test::Result();
+}
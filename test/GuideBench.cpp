@@ -0,0 +1,246 @@
+/*
+ *      Copyright (C) 2017-2019 Matthew Lundberg <matthew.k.lundberg@gmail.com>
+ *      https://github.com/MatthewLundberg/pvr.hdhomerun
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+
+// EPG window queries and aging out on the guide's slots and text arena,
+// against the layout before them: a set of whole entries ordered by start
+// time, with an index of the latest end so far, rebuilt after a change.
+
+#include "Guide.h"
+#include "GuideData.h"
+#include "GuideParser.h"
+#include "Test.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <set>
+#include <vector>
+
+using namespace PVRHDHomeRun;
+
+namespace
+{
+
+typedef std::chrono::steady_clock Clock;
+
+double Milliseconds(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+const unsigned Channels = 300;
+const int      Days     = 7;
+const time_t   Hour     = 3600;
+
+// The tag of a whole entry, as GuideEntry::Epg_Tag made it.
+EPG_TAG Tag(const Entry& e, uint32_t number)
+{
+    EPG_TAG tag = {0};
+    tag.iUniqueChannelId = number;
+    tag.strTitle         = e._title.c_str();
+    tag.strEpisodeName   = e._episodetitle.c_str();
+    tag.startTime        = e._starttime;
+    tag.endTime          = e._endtime;
+    tag.firstAired       = e._originalairdate;
+    tag.strPlot          = e._synopsis.c_str();
+    tag.strIconPath      = e._imageURL.c_str();
+    tag.iGenreType       = e._genre;
+    tag.iSeriesNumber    = e._season;
+    tag.iEpisodeNumber   = e._episode;
+    return tag;
+}
+
+class SetGuide
+{
+public:
+    void Add(const GuideEntry& e)
+    {
+        _entries.insert(e);
+        _valid = false;
+    }
+    template<typename F>
+    void ForEachInWindow(time_t start, time_t end, uint32_t number, F f)
+    {
+        if (!_valid)
+        {
+            _index.clear();
+            time_t maxend = 0;
+            for (auto& e : _entries)
+            {
+                maxend = std::max(maxend, e._endtime);
+                _index.push_back({maxend, &e});
+            }
+            _valid = true;
+        }
+        auto it = std::lower_bound(_index.begin(), _index.end(), start,
+                [](const std::pair<time_t, const GuideEntry*>& i, time_t t) { return i.first < t; });
+        for (; it != _index.end() && it->second->_starttime <= end; it++)
+        {
+            if (it->second->_endtime >= start)
+            {
+                EPG_TAG tag = Tag(*it->second, number);
+                f(tag);
+            }
+        }
+    }
+    void AgeOut(time_t limit)
+    {
+        for (auto it = _entries.begin(); it != _entries.end(); )
+        {
+            if (it->_endtime < limit)
+                it = _entries.erase(it);
+            else
+                it++;
+        }
+        _valid = false;
+    }
+    size_t Size() const
+    {
+        return _entries.size();
+    }
+
+private:
+    std::set<GuideEntry> _entries;
+    std::vector<std::pair<time_t, const GuideEntry*>> _index;
+    bool _valid = false;
+};
+
+// What Kodi is sent, so that the text is read as well.
+struct Sent
+{
+    size_t tags  = 0;
+    size_t bytes = 0;
+
+    void operator()(const EPG_TAG& tag)
+    {
+        tags++;
+        bytes += strlen(tag.strTitle) + strlen(tag.strPlot) + strlen(tag.strEpisodeName) + strlen(tag.strIconPath);
+    }
+    bool operator==(const Sent& o) const
+    {
+        return tags == o.tags && bytes == o.bytes;
+    }
+};
+
+// Kodi asks for a day around the current time, then for 6 hour windows
+// across the rest of the guide.
+template<typename Query>
+Sent Queries(Query query)
+{
+    Sent sent;
+    for (uint32_t channel = 0; channel < Channels; channel++)
+    {
+        query(channel, Test::GuideStart - 12 * Hour, Test::GuideStart + 12 * Hour, sent);
+        for (time_t start = Test::GuideStart; start < Test::GuideStart + Days * 24 * Hour; start += 6 * Hour)
+        {
+            query(channel, start, start + 6 * Hour, sent);
+        }
+    }
+    return sent;
+}
+
+} // namespace
+
+int main()
+{
+    GuideParser parser;
+    {
+        auto json = Test::GuideJSON(Channels, Test::GuideStart, Days * 24);
+        CHECK(parser.Feed(json.data(), json.size()) && parser.Finish());
+    }
+
+    GuideTable            table;
+    std::vector<uint32_t> ids;
+    std::vector<SetGuide> sets(Channels);
+    for (auto& channel : parser.Channels())
+    {
+        auto& guide = table.Insert(channel.number);
+        for (auto& entry : channel.entries)
+        {
+            sets[ids.size()].Add(entry);
+            guide.AddEntry(entry);
+        }
+        table.QueueAgeOut(channel.number);
+        ids.push_back(channel.number);
+    }
+    parser.Channels().clear();
+
+    // Both answer every query alike.
+    auto start = Clock::now();
+    auto slots = Queries([&](uint32_t channel, time_t s, time_t e, Sent& sent) {
+        table.Find(ids[channel])->ForEachInWindow(s, e, ids[channel], [&](EPG_TAG& tag) { sent(tag); });
+    });
+    auto slots_ms = Milliseconds(start);
+
+    start = Clock::now();
+    auto set = Queries([&](uint32_t channel, time_t s, time_t e, Sent& sent) {
+        sets[channel].ForEachInWindow(s, e, ids[channel], [&](EPG_TAG& tag) { sent(tag); });
+    });
+    auto set_ms = Milliseconds(start);
+
+    CHECK(slots == set);
+    printf("%u channels, %d days, %u tags from the windows Kodi asks for\n",
+            Channels, Days, static_cast<unsigned>(slots.tags));
+    printf("Queries:  slots %.1f ms, set %.1f ms\n", slots_ms, set_ms);
+
+    // Every hour of a day, with a query in between, as the update thread
+    // and Kodi go.
+    double slots_age = 0, set_age = 0, slots_query = 0, set_query = 0;
+    for (time_t limit = Test::GuideStart + Hour; limit <= Test::GuideStart + 24 * Hour; limit += Hour)
+    {
+        start = Clock::now();
+        table.AgeOut(limit);
+        slots_age += Milliseconds(start);
+
+        start = Clock::now();
+        for (auto& s : sets)
+        {
+            s.AgeOut(limit);
+        }
+        set_age += Milliseconds(start);
+
+        Sent a, b;
+        start = Clock::now();
+        for (uint32_t channel = 0; channel < Channels; channel++)
+        {
+            table.Find(ids[channel])->ForEachInWindow(limit, limit + 6 * Hour, ids[channel], a);
+        }
+        slots_query += Milliseconds(start);
+
+        start = Clock::now();
+        for (uint32_t channel = 0; channel < Channels; channel++)
+        {
+            sets[channel].ForEachInWindow(limit, limit + 6 * Hour, ids[channel], b);
+        }
+        set_query += Milliseconds(start);
+
+        CHECK(a == b);
+    }
+    for (uint32_t channel = 0; channel < Channels; channel++)
+    {
+        CHECK(table.Find(ids[channel])->Size() == sets[channel].Size());
+    }
+    printf("Age out hourly for a day:  slots %.1f ms, set %.1f ms\n", slots_age, set_age);
+    printf("Queries after each:        slots %.1f ms, set %.1f ms\n", slots_query, set_query);
+
+    return Test::Result();
+}
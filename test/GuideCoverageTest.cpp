@@ -0,0 +1,159 @@
+/*
+ *      Copyright (C) 2017-2019 Matthew Lundberg <matthew.k.lundberg@gmail.com>
+ *      https://github.com/MatthewLundberg/pvr.hdhomerun
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+
+// Checks GuideCoverage::Covered against the channels it counts, over
+// random coverage added and removed at any second.
+
+#include "GuideCoverage.h"
+#include "Test.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using namespace PVRHDHomeRun;
+
+namespace
+{
+
+const time_t   Start    = 1546300800; // On the hour
+const time_t   Domain   = 3 * 24 * 3600;
+const unsigned Channels = 8;
+
+std::default_random_engine generator(20190101);
+
+time_t Random(time_t limit)
+{
+    return std::uniform_int_distribution<time_t>(0, limit - 1)(generator);
+}
+
+Interval RandomInterval()
+{
+    time_t start = Start + Random(Domain);
+    return {start, start + 1 + Random(4 * 3600)};
+}
+
+struct Channel
+{
+    GuideCoverage::Channel hours;
+    IntervalSet            times;
+};
+
+bool AnyContains(const std::vector<Channel>& channels, time_t t)
+{
+    return std::any_of(channels.begin(), channels.end(),
+            [t](const Channel& channel) { return channel.times.Contains(t); });
+}
+
+// Every edge of every channel, either side, and some seconds in between.
+size_t Mismatches(const GuideCoverage& coverage, const std::vector<Channel>& channels)
+{
+    std::vector<time_t> times;
+    for (auto& channel : channels)
+    {
+        for (auto& i : channel.times.Intervals())
+        {
+            for (time_t t : {i.Start() - 1, i.Start(), i.End() - 1, i.End()})
+            {
+                times.push_back(t);
+            }
+        }
+    }
+    for (int n = 0; n < 100; n++)
+    {
+        times.push_back(Start + Random(Domain));
+    }
+
+    size_t mismatches = 0;
+    for (auto t : times)
+    {
+        mismatches += coverage.Covered(t) != AnyContains(channels, t);
+    }
+    return mismatches;
+}
+
+void Random()
+{
+    GuideCoverage        coverage;
+    std::vector<Channel> channels(Channels);
+
+    size_t mismatches = 0;
+    for (int op = 0; op < 2000; op++)
+    {
+        auto& channel = channels[Random(Channels)];
+        auto  i       = RandomInterval();
+
+        // As Guide does, only what is newly covered, or still covered.
+        if (Random(3))
+        {
+            for (auto& gap : channel.times.Gaps(i))
+            {
+                coverage.Add(channel.hours, gap);
+            }
+            channel.times.Add(i);
+        }
+        else
+        {
+            for (auto& piece : channel.times.Overlap(i))
+            {
+                coverage.Remove(channel.hours, piece);
+            }
+            channel.times.Remove(i);
+        }
+        mismatches += Mismatches(coverage, channels);
+    }
+    CHECK(mismatches == 0);
+
+    for (auto& channel : channels)
+    {
+        coverage.Drop(channel.hours, channel.times);
+        channel.times = IntervalSet();
+        CHECK(Mismatches(coverage, channels) == 0);
+    }
+    CHECK(coverage.Channels() == 0);
+    CHECK(coverage.EarliestGap(Start, Start + Domain) == Start);
+}
+
+// Covered to the second, however little of the hour is.
+void Edges()
+{
+    GuideCoverage coverage;
+    Channel       a, b;
+
+    coverage.Add(a.hours, {Start + 600, Start + 1200});
+    coverage.Add(b.hours, {Start + 1200, Start + 1800});
+    CHECK(!coverage.Covered(Start + 599));
+    CHECK(coverage.Covered(Start + 600) && coverage.Covered(Start + 1799));
+    CHECK(!coverage.Covered(Start + 1800));
+
+    coverage.Remove(a.hours, {Start + 600, Start + 1200});
+    CHECK(!coverage.Covered(Start + 1199) && coverage.Covered(Start + 1200));
+}
+
+} // namespace
+
+int main()
+{
+    Edges();
+    Random();
+    return Test::Result();
+}
@@ -0,0 +1,89 @@
+#pragma once
+/*
+ *      Copyright (C) 2017-2019 Matthew Lundberg <matthew.k.lundberg@gmail.com>
+ *      https://github.com/MatthewLundberg/pvr.hdhomerun
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+
+// guide.php responses for the tests and benchmarks.
+
+#include <cstdio>
+#include <ctime>
+#include <string>
+
+namespace PVRHDHomeRun
+{
+namespace Test
+{
+
+const time_t GuideStart = 1546300800; // On the hour
+
+// 'channels' channels with a programme every half hour for 'hours' hours
+// from 'start'.  Series titles and images repeat across channels and days,
+// episode titles and synopses do not.  Some text is escaped, and keys the
+// add-on does not use are included, as guide.php sends them.
+inline std::string GuideJSON(unsigned channels, time_t start, int hours)
+{
+    static const char* const titles[] = {
+        "News at Noon", "The \\\"Late\\\" Show", "Caf\\u00e9 Society", "Antiques Roadshow",
+        "Nature", "NOVA", "Jeopardy!", "Wheel of Fortune", "The Simpsons", "Frontline",
+        "Masterpiece", "Sesame Street", "Weather Now", "Local Sports", "Movie of the Week",
+        "Cooking with Julia",
+    };
+    static const char* const filters[] = {
+        "[\"News\"]", "[\"Talk Show\"]", "[\"Food\"]", "[]", "[\"Movie\",\"Drama\"]", "[\"Sports\"]",
+    };
+    const size_t series = sizeof(titles) / sizeof(titles[0]);
+
+    std::string s = "[";
+    char buffer[1024];
+    for (unsigned channel = 0; channel < channels; channel++)
+    {
+        snprintf(buffer, sizeof(buffer),
+                "%s{\"GuideNumber\":\"%u.%u\",\"GuideName\":\"CH%u\",\"Affiliate\":\"AFF%u\","
+                "\"ImageURL\":\"http://img.hdhomerun.com/channels/%u.png\",\"Unused\":{\"a\":[1,2,{\"b\":null}]},"
+                "\"Guide\":[",
+                channel ? "," : "", channel / 4 + 2, channel % 4 + 1, channel, channel % 7, channel);
+        s += buffer;
+
+        for (int slot = 0; slot < hours * 2; slot++)
+        {
+            time_t t = start + slot * 1800;
+            size_t n = (channel + slot / 2) % series;
+            snprintf(buffer, sizeof(buffer),
+                    "%s{\"StartTime\":%ld,\"EndTime\":%ld,\"First\":true,\"Title\":\"%s\","
+                    "\"EpisodeNumber\":\"S%02uE%02u\",\"EpisodeTitle\":\"Episode %u of %u\","
+                    "\"Synopsis\":\"What happens on channel %u at %ld, told at some length as the guide does.\","
+                    "\"OriginalAirdate\":%ld,\"ImageURL\":\"http://img.hdhomerun.com/titles/C%06uENG.jpg\","
+                    "\"SeriesID\":\"C%06uENG\",\"Filter\":%s%s}",
+                    slot ? "," : "", static_cast<long>(t), static_cast<long>(t + 1800), titles[n],
+                    static_cast<unsigned>(n % 20 + 1), static_cast<unsigned>(slot % 24 + 1),
+                    static_cast<unsigned>(slot), channel, channel, static_cast<long>(t),
+                    static_cast<long>(t - 86400 * (slot % 365)),
+                    static_cast<unsigned>(n), static_cast<unsigned>(n), filters[n % 6],
+                    n == 3 ? ",\"RecordingRule\":1" : "");
+            s += buffer;
+        }
+        s += "]}";
+    }
+    return s + "]";
+}
+
+} // namespace Test
+} // namespace PVRHDHomeRun
@@ -0,0 +1,229 @@
+/*
+ *      Copyright (C) 2017-2019 Matthew Lundberg <matthew.k.lundberg@gmail.com>
+ *      https://github.com/MatthewLundberg/pvr.hdhomerun
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+
+// GuideParser against the jsoncpp path it replaced, which read the whole
+// response, parsed it into a Json::Value and built the entries from that.
+// Both must give the same channels and entries.  The time and the peak
+// heap of each are reported.
+
+#include "GuideData.h"
+#include "GuideParser.h"
+#include "Test.h"
+#include "Utils.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+using namespace PVRHDHomeRun;
+
+namespace
+{
+// Each allocation is preceded by its size.
+const size_t Header = alignof(std::max_align_t);
+size_t live = 0;
+size_t peak = 0;
+}
+
+void* operator new(size_t n)
+{
+    if (auto p = static_cast<char*>(malloc(n + Header)))
+    {
+        *reinterpret_cast<size_t*>(p) = n;
+        live += n;
+        peak  = std::max(peak, live);
+        return p + Header;
+    }
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept
+{
+    if (!p)
+        return;
+    auto q = static_cast<char*>(p) - Header;
+    live -= *reinterpret_cast<size_t*>(q);
+    free(q);
+}
+void operator delete(void* p, size_t) noexcept
+{
+    operator delete(p);
+}
+
+namespace
+{
+
+typedef std::chrono::steady_clock Clock;
+
+double Milliseconds(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+struct Channel
+{
+    GuideNumber        number{0};
+    std::string        affiliate;
+    std::string        imageURL;
+    std::vector<Entry> entries;
+};
+
+// As _fetch_guide_data and _insert_json_guide_data did.
+bool ParseDOM(const std::string& guidedata, std::vector<Channel>& channels)
+{
+    if (guidedata.substr(0, 4) == "null")
+        return true;
+
+    Json::Value jsondeviceguide;
+    std::string err;
+    if (!StringToJson(guidedata, jsondeviceguide, err) || jsondeviceguide.type() != Json::arrayValue)
+        return false;
+
+    for (auto& jsonchannelguide : jsondeviceguide)
+    {
+        Channel channel;
+        channel.number    = GuideNumber(jsonchannelguide);
+        channel.affiliate = jsonchannelguide["Affiliate"].asString();
+        channel.imageURL  = jsonchannelguide["ImageURL"].asString();
+        for (auto& jsonentry : jsonchannelguide["Guide"])
+        {
+            channel.entries.push_back(Entry(jsonentry));
+        }
+        channels.push_back(std::move(channel));
+    }
+    return true;
+}
+
+bool ParseStream(const std::string& json, size_t chunk, GuideParser& parser)
+{
+    for (size_t pos = 0; pos < json.size(); pos += chunk)
+    {
+        if (!parser.Feed(json.data() + pos, std::min(chunk, json.size() - pos)))
+            return false;
+    }
+    return parser.Finish();
+}
+
+bool Same(const Entry& a, const Entry& b)
+{
+    return a == b
+        && a.ContentHash() == b.ContentHash()
+        && a.PreferredID() == b.PreferredID()
+        && a._marked == b._marked
+        && a._genre  == b._genre;
+}
+
+void Compare(std::vector<GuideParser::Channel>& parsed, const std::vector<Channel>& dom)
+{
+    CHECK(parsed.size() == dom.size());
+    for (size_t i = 0; i < std::min(parsed.size(), dom.size()); i++)
+    {
+        auto& p = parsed[i];
+        auto& d = dom[i];
+        CHECK(p.number.ID() == d.number.ID() && p.number._guidename == d.number._guidename);
+        CHECK(p.affiliate == d.affiliate && p.imageURL == d.imageURL);
+        CHECK(p.entries.size() == d.entries.size());
+
+        size_t same = 0;
+        for (size_t e = 0; e < std::min(p.entries.size(), d.entries.size()); e++)
+        {
+            same += Same(p.entries[e], d.entries[e]);
+        }
+        CHECK(same == d.entries.size());
+    }
+}
+
+// However the response is split, the result is the same.
+void Chunks()
+{
+    auto json = Test::GuideJSON(10, Test::GuideStart, 24);
+
+    std::vector<Channel> dom;
+    CHECK(ParseDOM(json, dom));
+    CHECK(dom.size() == 10);
+    for (size_t chunk : {static_cast<size_t>(1), static_cast<size_t>(7), json.size()})
+    {
+        GuideParser parser;
+        CHECK(ParseStream(json, chunk, parser));
+        Compare(parser.Channels(), dom);
+    }
+}
+
+void Null()
+{
+    GuideParser parser;
+    std::vector<Channel> dom;
+    CHECK(ParseStream("null", 1, parser) && parser.Channels().empty());
+    CHECK(ParseDOM("null", dom) && dom.empty());
+}
+
+// A day of 300 channels, in the 64 KB reads of the HTTP client.
+void Large()
+{
+    const size_t read = 64 * 1024;
+    const auto   json = Test::GuideJSON(300, Test::GuideStart, 24);
+
+    size_t base = live;
+    peak = live;
+    auto start = Clock::now();
+    GuideParser parser;
+    CHECK(ParseStream(json, read, parser));
+    auto   stream_ms   = Milliseconds(start);
+    size_t stream_peak = peak - base;
+
+    // The whole response is read before it is parsed.
+    base = live;
+    peak = live;
+    start = Clock::now();
+    std::vector<Channel> dom;
+    {
+        std::string guidedata(json);
+        CHECK(ParseDOM(guidedata, dom));
+    }
+    auto   dom_ms   = Milliseconds(start);
+    size_t dom_peak = peak - base;
+
+    Compare(parser.Channels(), dom);
+
+    size_t entries = 0;
+    for (auto& channel : dom)
+    {
+        entries += channel.entries.size();
+    }
+    printf("%.1f MB, %u channels, %u entries\n", json.size() / 1048576.0,
+            static_cast<unsigned>(dom.size()), static_cast<unsigned>(entries));
+    printf("GuideParser: %.1f ms, peak %.1f MB\n", stream_ms, stream_peak / 1048576.0);
+    printf("jsoncpp:     %.1f ms, peak %.1f MB\n", dom_ms, dom_peak / 1048576.0);
+    CHECK(stream_peak < dom_peak);
+}
+
+} // namespace
+
+int main()
+{
+    Chunks();
+    Null();
+    Large();
+    return Test::Result();
+}
@@ -0,0 +1,199 @@
+/*
+ *      Copyright (C) 2017-2019 Matthew Lundberg <matthew.k.lundberg@gmail.com>
+ *      https://github.com/MatthewLundberg/pvr.hdhomerun
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+
+// Drives GuideScheduler against fake guides, the way the extended guide
+// planner in PVR_HDHR does, and reports the requests made and the time
+// taken to fill the guide.
+
+#include "GuideScheduler.h"
+#include "Addon.h"
+#include "Test.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+using namespace PVRHDHomeRun;
+
+namespace
+{
+
+const time_t Start = 1546300800; // On the hour
+const time_t Basic = 4 * 3600;    // Returned by the basic guide request
+
+struct FakeGuide
+{
+    IntervalSet times;
+    IntervalSet requests;
+};
+
+// guide.php returns guideExtendedEach seconds from the start asked for.
+void Fetch(GuideScheduler& schedule, std::vector<FakeGuide>& guides, const GuideScheduler::Job& job)
+{
+    auto& guide = guides[job.number];
+    Interval returned(job.start, job.start + g.Settings.guideExtendedEach);
+    guide.times.Add(returned);
+    guide.requests.Remove(returned);
+    schedule.Done(job.number, job.start);
+}
+
+// One update pass of _plan_extended_guide.
+void Pass(GuideScheduler& schedule, std::vector<FakeGuide>& guides, time_t now)
+{
+    schedule.Begin();
+    for (uint32_t number = 0; number < guides.size(); number++)
+    {
+        guides[number].requests.Remove({0, now});
+        schedule.Add(number, guides[number].requests, now);
+    }
+}
+
+// One tick of UpdateExtendedGuide.
+size_t Tick(GuideScheduler& schedule, std::vector<FakeGuide>& guides, time_t now)
+{
+    auto jobs = schedule.Dispatch(now, g.Settings.guideWorkers);
+    for (const auto& job : jobs)
+    {
+        Fetch(schedule, guides, job);
+    }
+    return jobs.size();
+}
+
+void FullCoverage(uint32_t channels, int days)
+{
+    const time_t window = days * 24 * 3600;
+
+    // The extended guide grows from the end of the basic guide.
+    GuideScheduler     schedule;
+    std::vector<FakeGuide> guides(channels);
+    for (auto& guide : guides)
+    {
+        guide.times.Add({Start, Start + Basic});
+        guide.requests.Add({Start + Basic, Start + window});
+    }
+
+    // The update thread ticks every second, each tick fetches as many as
+    // there are workers.
+    size_t requests = 0;
+    int    ticks    = 0;
+    size_t largest  = 0;
+    time_t now      = Start;
+    auto unfilled = [&]() {
+        return std::any_of(guides.begin(), guides.end(),
+                [](const FakeGuide& guide) { return !guide.requests.Empty(); });
+    };
+    while (unfilled() && ticks < 100000)
+    {
+        if (ticks % g.Settings.guideUpdateInterval == 0)
+            Pass(schedule, guides, now);
+
+        size_t n = Tick(schedule, guides, now);
+        requests += n;
+        largest   = std::max(largest, n);
+        ticks ++;
+        now ++;
+    }
+
+    time_t each    = g.Settings.guideExtendedEach;
+    size_t minimum = channels * ((window - Basic + each - 1) / each);
+    size_t workers = g.Settings.guideWorkers;
+    printf("%u channels, %d days: %u requests (minimum %u), full coverage after %d ticks, %d minutes\n",
+            channels, days, static_cast<unsigned>(requests), static_cast<unsigned>(minimum),
+            ticks, static_cast<int>((now - Start) / 60));
+
+    // Every tick but those held back by the stagger fetches a full round.
+    CHECK(!unfilled());
+    CHECK(requests == minimum);
+    CHECK(largest == workers);
+    CHECK(ticks <= static_cast<int>((minimum + workers - 1) / workers) + g.Settings.guideRandom + 1);
+    CHECK(std::all_of(guides.begin(), guides.end(), [&](const FakeGuide& guide) {
+        return guide.times.Count() == 1 && guide.times.Start() == Start && guide.times.End() >= Start + window;
+    }));
+}
+
+// A window Kodi asks for again and again is fetched once, and a job in
+// flight is not dispatched by the regular passes.
+void DemandInFlight()
+{
+    const time_t each = g.Settings.guideExtendedEach;
+
+    GuideScheduler schedule;
+    IntervalSet    requests({Start, Start + 2*each});
+    time_t         later = Start + g.Settings.guideRandom + 1;
+
+    schedule.Demand(1, {Start, Start + 60});
+    schedule.Begin();
+    schedule.Add(1, requests, Start);
+
+    auto urgent = schedule.DispatchDemand(4);
+    CHECK(urgent.size() == 1 && urgent[0].start == Start && urgent[0].urgent);
+
+    schedule.Demand(1, {Start, Start + 60});
+    CHECK(schedule.DispatchDemand(4).empty());
+
+    schedule.Begin();
+    schedule.Add(1, requests, later);
+    auto jobs = schedule.Dispatch(later, 10);
+    CHECK(jobs.size() == 1 && jobs[0].start == Start + each);
+    schedule.Done(1, Start + each);
+
+    // Once done, the job returns at normal priority.
+    schedule.Done(1, Start);
+    schedule.Begin();
+    schedule.Add(1, requests, later);
+    jobs = schedule.Dispatch(later, 10);
+    CHECK(jobs.size() == 2 && jobs[0].start == Start && !jobs[0].urgent);
+}
+
+// The jobs of a pass are kept until their stagger has passed, and a job
+// dispatched for demand in the meantime is not dispatched again.
+void Queued()
+{
+    const time_t each = g.Settings.guideExtendedEach;
+
+    GuideScheduler schedule;
+    schedule.Begin();
+    schedule.Add(1, IntervalSet({Start, Start + 4*each}), Start);
+
+    time_t later = Start + g.Settings.guideRandom + 1;
+    CHECK(schedule.Dispatch(Start - 1, 10).empty());
+
+    schedule.Demand(1, {Start, Start + 60});
+    auto urgent = schedule.DispatchDemand(4);
+    CHECK(urgent.size() == 1 && urgent[0].start == Start);
+
+    auto jobs = schedule.Dispatch(later, 2);
+    CHECK(jobs.size() == 2 && jobs[0].start == Start + each && jobs[1].start == Start + 2*each);
+    jobs = schedule.Dispatch(later, 2);
+    CHECK(jobs.size() == 1 && jobs[0].start == Start + 3*each);
+    CHECK(schedule.Dispatch(later, 2).empty());
+}
+
+} // namespace
+
+int main()
+{
+    DemandInFlight();
+    Queued();
+    FullCoverage(300, 7);
+    return Test::Result();
+}
@@ -0,0 +1,205 @@
+/*
+ *      Copyright (C) 2017-2019 Matthew Lundberg <matthew.k.lundberg@gmail.com>
+ *      https://github.com/MatthewLundberg/pvr.hdhomerun
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+
+// PooledHttpClient against a local server: the framings it reads, what it
+// hands to the fallback and what it reports as a failure.
+
+#include "HttpClient.h"
+#include "LocalServer.h"
+#include "Test.h"
+#include "Utils.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <string>
+
+using namespace PVRHDHomeRun;
+
+namespace
+{
+const uint64_t ReadTimeout = 200; // ms
+
+std::string Body(size_t size)
+{
+    std::string body;
+    for (size_t i = 0; body.size() < size; i++)
+    {
+        body += std::to_string(i) + ",";
+    }
+    body.resize(size);
+    return body;
+}
+
+void Framings()
+{
+    auto body = Body(200000);
+    Test::LocalServer server([&](const std::string& path) {
+        if (path == "/length")
+            return Test::Response::Ok(body);
+        if (path == "/chunked")
+            return Test::Response::Chunked(body, 7000);
+        return Test::Response::Closed(body);
+    });
+    Test::FallbackCounter fallback;
+    PooledHttpClient      client(fallback, ReadTimeout);
+
+    for (auto path : {"/length", "/chunked", "/closed"})
+    {
+        std::string got;
+        CHECK(client.Get(server.URL(path), got, 0));
+        CHECK(got == body);
+
+        std::string streamed;
+        CHECK(client.Stream(server.URL(path), [&](const char* data, size_t size) {
+            streamed.append(data, size);
+            return true;
+        }, 0));
+        CHECK(streamed == body);
+    }
+    CHECK(fallback.calls == 0);
+
+    // One connection until the first closed response, another for the second.
+    CHECK(server.Requests() == 6);
+    CHECK(server.Connections() == 2);
+}
+
+void CutShort()
+{
+    Test::LocalServer server([](const std::string& path) {
+        if (path == "/stalled")
+        {
+            auto r  = Test::Response::Closed("partial");
+            r.stall = 3 * ReadTimeout;
+            return r;
+        }
+        // More than could ever be reserved
+        return Test::Response("HTTP/1.1 200 OK\r\nContent-Length: 1000000000000000\r\n\r\npartial", true);
+    });
+    Test::FallbackCounter fallback;
+    PooledHttpClient      client(fallback, ReadTimeout);
+
+    std::string body;
+    CHECK(!client.Get(server.URL("/stalled"), body, 0));
+    CHECK(!client.Get(server.URL("/length"), body, 0));
+    CHECK(fallback.calls == 0);
+}
+
+void Statuses()
+{
+    Test::LocalServer server([](const std::string& path) {
+        if (path == "/moved")
+            return Test::Response::Status(302, "Location: /elsewhere\r\n");
+        return Test::Response::Status(404);
+    });
+    Test::FallbackCounter fallback;
+    PooledHttpClient      client(fallback, ReadTimeout);
+
+    std::string body;
+    CHECK(!client.Get(server.URL("/missing"), body, 0));
+    CHECK(fallback.calls == 0);
+    CHECK(server.Requests() == 1);
+
+    // Redirects are the VFS's to follow.
+    CHECK(!client.Get(server.URL("/moved"), body, 0));
+    CHECK(fallback.calls == 1);
+    CHECK(server.Requests() == 2);
+
+    // As are these, without asking the server.
+    CHECK(!client.Get("https://127.0.0.1/", body, 0));
+    CHECK(!client.Get(server.URL("/options|User-Agent=test"), body, 0));
+    CHECK(fallback.calls == 3);
+    CHECK(server.Requests() == 2);
+}
+
+void Stale()
+{
+    Test::LocalServer server([](const std::string&) { return Test::Response::Ok("fresh"); });
+    Test::FallbackCounter fallback;
+    PooledHttpClient      client(fallback, ReadTimeout);
+
+    std::string body;
+    CHECK(client.Get(server.URL("/"), body, 0));
+    CHECK(client.Get(server.URL("/"), body, 0));
+    CHECK(server.Connections() == 1);
+
+    // The kept connection is found closed and the request is sent again.
+    server.CloseIdle();
+    CHECK(client.Get(server.URL("/"), body, 0));
+    CHECK(body == "fresh");
+    CHECK(server.Connections() == 2);
+    CHECK(fallback.calls == 0);
+}
+
+void Unreachable()
+{
+    // Bound, but not listening, so connecting is refused.
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr = {};
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+    socklen_t len = sizeof(addr);
+    getsockname(sock, reinterpret_cast<sockaddr*>(&addr), &len);
+    auto url = "http://127.0.0.1:" + std::to_string(ntohs(addr.sin_port)) + "/";
+
+    Test::FallbackCounter fallback;
+    PooledHttpClient      client(fallback, ReadTimeout);
+
+    // The failure is reported, later requests go to the fallback.
+    std::string body;
+    CHECK(!client.Get(url, body, 1));
+    CHECK(fallback.calls == 0);
+    CHECK(!client.Get(url, body, 1));
+    CHECK(fallback.calls == 1);
+
+    close(sock);
+}
+
+void Injected()
+{
+    Test::FallbackCounter injected;
+    SetDefaultHttpClient(&injected);
+    CHECK(&DefaultHttpClient() == &injected);
+
+    std::string body;
+    GetFileContents("http://127.0.0.1/", body);
+    StreamFileContents("http://127.0.0.1/", [](const char*, size_t) { return true; });
+    CHECK(injected.calls == 2);
+
+    SetDefaultHttpClient(nullptr);
+    CHECK(&DefaultHttpClient() != &injected);
+}
+}
+
+int main()
+{
+    Framings();
+    CutShort();
+    Statuses();
+    Stale();
+    Unreachable();
+    Injected();
+    return Test::Result();
+}
@@ -0,0 +1,100 @@
+/*
+ *      Copyright (C) 2017-2019 Matthew Lundberg <matthew.k.lundberg@gmail.com>
+ *      https://github.com/MatthewLundberg/pvr.hdhomerun
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+
+// Times IntervalSet under the work a channel's guide gives it: entries
+// covering their times and filling requests, lookups, and aging out.
+
+#include "IntervalSet.h"
+#include "Test.h"
+
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+using namespace PVRHDHomeRun;
+
+namespace
+{
+
+const time_t Entry   = 1800;
+const time_t Day     = 24 * 3600;
+const time_t Days    = 14;
+const time_t AgedOut = 3 * Day;
+
+// Returns true if the sets end up as expected.
+bool Channel()
+{
+    IntervalSet times;
+    IntervalSet requests;
+
+    // Requested in 8 hour pieces, every fifth one missing.
+    for (time_t start = 0; start < Days * Day; start += 8 * 3600)
+    {
+        if ((start / (8 * 3600)) % 5 != 4)
+            requests.Add({start, start + 8 * 3600});
+    }
+
+    // Guide::AddEntry
+    std::vector<Interval> entries;
+    for (time_t start = 0; start < Days * Day; start += Entry)
+    {
+        Interval i(start, start + Entry);
+        entries.push_back(i);
+        times.Add(i);
+        requests.Remove(i);
+    }
+
+    // GetEPGForChannel and the planners
+    size_t found = 0;
+    for (time_t t = 0; t < Days * Day; t += 600)
+    {
+        found += times.Contains(t);
+        found += requests.Contains(t);
+    }
+
+    // Guide::_age_out
+    std::vector<Interval> stale(entries.begin(), entries.begin() + AgedOut / Entry);
+    times.Remove(stale);
+    requests.Remove({0, AgedOut});
+
+    return found == static_cast<size_t>(Days * Day / 600)
+        && times.Count() == 1 && times.Start() == AgedOut && times.End() == Days * Day
+        && requests.Empty();
+}
+
+} // namespace
+
+int main()
+{
+    const int channels = 300;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int n = 0; n < channels; n++)
+    {
+        CHECK(Channel());
+    }
+    auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start);
+
+    printf("%d channels of %d days: %.1f ms, %.3f ms per channel\n",
+            channels, static_cast<int>(Days), elapsed.count(), elapsed.count() / channels);
+    return Test::Result();
+}
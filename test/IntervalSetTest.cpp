@@ -0,0 +1,188 @@
+/*
+ *      Copyright (C) 2017-2019 Matthew Lundberg <matthew.k.lundberg@gmail.com>
+ *      https://github.com/MatthewLundberg/pvr.hdhomerun
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+
+// Checks IntervalSet against a bitmap of the same times, over random
+// single and batched operations.
+
+#include "IntervalSet.h"
+#include "Test.h"
+
+#include <algorithm>
+#include <bitset>
+#include <random>
+#include <vector>
+
+using namespace PVRHDHomeRun;
+
+namespace
+{
+
+const time_t Domain = 256;
+typedef std::bitset<Domain> Bitmap;
+
+std::default_random_engine generator(20190101);
+
+time_t Random(time_t limit)
+{
+    return std::uniform_int_distribution<time_t>(0, limit - 1)(generator);
+}
+
+// Sometimes empty, sometimes reaching past the end of the domain.
+Interval RandomInterval()
+{
+    time_t start = Random(Domain);
+    time_t end   = std::min(Domain, start + Random(48));
+    return {start, end};
+}
+
+std::vector<Interval> RandomBatch()
+{
+    std::vector<Interval> batch;
+    for (auto n = Random(12); n > 0; n--)
+    {
+        batch.push_back(RandomInterval());
+    }
+    std::sort(batch.begin(), batch.end());
+    return batch;
+}
+
+void Set(Bitmap& b, const Interval& i, bool value)
+{
+    for (time_t t = i.Start(); t < i.End(); t++)
+    {
+        b[t] = value;
+    }
+}
+
+void Compare(const IntervalSet& set, const Bitmap& model)
+{
+    Bitmap got;
+    time_t prev_end = -1;
+    for (const auto& i : set.Intervals())
+    {
+        // Disjoint, not touching and not empty.
+        CHECK(i.Start() > prev_end);
+        CHECK(i.Start() < i.End());
+        prev_end = i.End();
+        Set(got, i, true);
+    }
+    CHECK(got == model);
+    CHECK(set.Length() == static_cast<time_t>(model.count()));
+
+    for (time_t t = 0; t < Domain; t++)
+    {
+        CHECK(set.Contains(t) == model[t]);
+    }
+
+    auto o = RandomInterval();
+    Bitmap overlap, gaps;
+    for (const auto& piece : set.Overlap(o))
+    {
+        Set(overlap, piece, true);
+    }
+    for (const auto& piece : set.Gaps(o))
+    {
+        Set(gaps, piece, true);
+    }
+    Bitmap window;
+    Set(window, o, true);
+    CHECK(overlap == (model & window));
+    CHECK(gaps == (window & ~model));
+}
+
+void Model(int operations)
+{
+    IntervalSet set;
+    Bitmap      model;
+
+    for (int n = 0; n < operations; n++)
+    {
+        switch (Random(6))
+        {
+        case 0:
+        {
+            auto i = RandomInterval();
+            set.Add(i);
+            Set(model, i, true);
+            break;
+        }
+        case 1:
+        {
+            auto i = RandomInterval();
+            set.Remove(i);
+            Set(model, i, false);
+            break;
+        }
+        case 2:
+        {
+            auto batch = RandomBatch();
+            set.Add(batch);
+            for (auto& i : batch)
+                Set(model, i, true);
+            break;
+        }
+        case 3:
+        {
+            auto batch = RandomBatch();
+            set.Remove(batch);
+            for (auto& i : batch)
+                Set(model, i, false);
+            break;
+        }
+        case 4:
+        {
+            IntervalSet other;
+            Bitmap      other_model;
+            for (auto& i : RandomBatch())
+            {
+                other.Add(i);
+                Set(other_model, i, true);
+            }
+            set.Add(other);
+            model |= other_model;
+            break;
+        }
+        case 5:
+        {
+            IntervalSet other;
+            Bitmap      other_model;
+            for (auto& i : RandomBatch())
+            {
+                other.Add(i);
+                Set(other_model, i, true);
+            }
+            set.Remove(other);
+            model &= ~other_model;
+            break;
+        }
+        }
+        Compare(set, model);
+    }
+}
+
+} // namespace
+
+int main()
+{
+    Model(20000);
+    return Test::Result();
+}
@@ -0,0 +1,243 @@
+#pragma once
+/*
+ *      Copyright (C) 2017-2019 Matthew Lundberg <matthew.k.lundberg@gmail.com>
+ *      https://github.com/MatthewLundberg/pvr.hdhomerun
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+
+// An HTTP/1.1 server on 127.0.0.1 for the HttpClient tests, POSIX only.
+// Each connection is served by a thread of its own.
+
+#include "HttpClient.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace PVRHDHomeRun
+{
+namespace Test
+{
+
+struct Response
+{
+    std::string data;  // Sent as is
+    bool        close; // Close the connection after sending
+    int         stall; // ms to wait after sending
+
+    Response(const std::string& d = "", bool c = false, int s = 0)
+        : data(d)
+        , close(c)
+        , stall(s)
+    {}
+
+    static Response Ok(const std::string& body)
+    {
+        return {"HTTP/1.1 200 OK\r\nContent-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body};
+    }
+    static Response Chunked(const std::string& body, size_t chunk)
+    {
+        Response r;
+        r.data = "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n";
+        for (size_t pos = 0; pos < body.size(); pos += chunk)
+        {
+            auto piece = body.substr(pos, chunk);
+            char size[32];
+            snprintf(size, sizeof(size), "%zx\r\n", piece.size());
+            r.data += size + piece + "\r\n";
+        }
+        r.data += "0\r\n\r\n";
+        return r;
+    }
+    // Ends with the connection.
+    static Response Closed(const std::string& body)
+    {
+        return {"HTTP/1.1 200 OK\r\nConnection: close\r\n\r\n" + body, true};
+    }
+    static Response Status(int status, const std::string& headers = "")
+    {
+        return {"HTTP/1.1 " + std::to_string(status) + " Status\r\nContent-Length: 0\r\n" + headers + "\r\n"};
+    }
+};
+
+class LocalServer
+{
+public:
+    typedef std::function<Response(const std::string& path)> Handler;
+
+    LocalServer(Handler handler)
+        : _handler(handler)
+    {
+        _listen = socket(AF_INET, SOCK_STREAM, 0);
+        int one = 1;
+        setsockopt(_listen, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+        sockaddr_in addr = {};
+        addr.sin_family      = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        bind(_listen, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+        listen(_listen, 16);
+
+        socklen_t len = sizeof(addr);
+        getsockname(_listen, reinterpret_cast<sockaddr*>(&addr), &len);
+        _port = ntohs(addr.sin_port);
+
+        _accept = std::thread(&LocalServer::_accept_loop, this);
+    }
+    ~LocalServer()
+    {
+        _stop = true;
+        _accept.join();
+        for (auto& t : _connections)
+        {
+            t.join();
+        }
+        close(_listen);
+    }
+
+    std::string URL(const std::string& path) const
+    {
+        return "http://127.0.0.1:" + std::to_string(_port) + path;
+    }
+    int Connections() const
+    {
+        return _accepted;
+    }
+    int Requests() const
+    {
+        return _requests;
+    }
+    // Closes every connection waiting for a request, as a server does with
+    // idle connections.
+    void CloseIdle()
+    {
+        _close_idle++;
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+
+private:
+    static bool _readable(int sock)
+    {
+        pollfd p = {sock, POLLIN, 0};
+        return poll(&p, 1, 10) > 0;
+    }
+
+    void _accept_loop()
+    {
+        while (!_stop)
+        {
+            if (!_readable(_listen))
+                continue;
+            int sock = accept(_listen, nullptr, nullptr);
+            if (sock < 0)
+                continue;
+            _accepted++;
+            std::lock_guard<std::mutex> lock(_mutex);
+            _connections.emplace_back(&LocalServer::_serve, this, sock);
+        }
+    }
+
+    void _serve(int sock)
+    {
+        int idle_generation = _close_idle;
+        std::string pending;
+        while (!_stop)
+        {
+            auto end = pending.find("\r\n\r\n");
+            if (end == std::string::npos)
+            {
+                if (pending.empty() && idle_generation != _close_idle)
+                    break;
+                if (!_readable(sock))
+                    continue;
+                char buffer[4096];
+                auto n = recv(sock, buffer, sizeof(buffer), 0);
+                if (n <= 0)
+                    break;
+                pending.append(buffer, n);
+                continue;
+            }
+
+            // "GET /path HTTP/1.1"
+            auto space = pending.find(' ');
+            auto path  = pending.substr(space + 1, pending.find(' ', space + 1) - space - 1);
+            pending.erase(0, end + 4);
+            _requests++;
+
+            auto response = _handler(path);
+            for (size_t sent = 0; sent < response.data.size(); )
+            {
+                auto n = send(sock, response.data.data() + sent, response.data.size() - sent, MSG_NOSIGNAL);
+                if (n <= 0)
+                    break;
+                sent += n;
+            }
+            if (response.stall)
+                std::this_thread::sleep_for(std::chrono::milliseconds(response.stall));
+            if (response.close)
+                break;
+            idle_generation = _close_idle;
+        }
+        close(sock);
+    }
+
+    Handler                  _handler;
+    int                      _listen;
+    uint16_t                 _port;
+    std::thread              _accept;
+    std::mutex               _mutex;
+    std::vector<std::thread> _connections;
+    std::atomic<bool>        _stop{false};
+    std::atomic<int>         _accepted{0};
+    std::atomic<int>         _requests{0};
+    std::atomic<int>         _close_idle{0};
+};
+
+// Stands in for Kodi's VFS behind PooledHttpClient, counting what is
+// handed to it.
+class FallbackCounter : public HttpClient
+{
+public:
+    bool Get(const std::string&, std::string&, int) override
+    {
+        calls++;
+        return false;
+    }
+    bool Stream(const std::string&, const HttpSink&, int) override
+    {
+        calls++;
+        return false;
+    }
+
+    std::atomic<int> calls{0};
+};
+
+} // namespace Test
+} // namespace PVRHDHomeRun
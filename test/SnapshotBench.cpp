@@ -0,0 +1,200 @@
+/*
+ *      Copyright (C) 2017-2019 Matthew Lundberg <matthew.k.lundberg@gmail.com>
+ *      https://github.com/MatthewLundberg/pvr.hdhomerun
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+
+// Startup with and without a snapshot, for the guide, which is most of the
+// state.  A cold start fetches and merges the basic guide of every channel
+// before Kodi has anything to show, and needs hundreds of rate limited
+// requests for the full guide.  A warm start reads the whole guide back.
+
+#include "Guide.h"
+#include "GuideData.h"
+#include "GuideParser.h"
+#include "LocalServer.h"
+#include "Snapshot.h"
+#include "Test.h"
+#include "Utils.h"
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+using namespace PVRHDHomeRun;
+
+namespace
+{
+
+typedef std::chrono::steady_clock Clock;
+
+double Milliseconds(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+const unsigned Channels = 300;
+const int      Basic    = 4;       // Hours, from the basic guide request
+const int      Days     = 7;
+
+// PVR_HDHR::_insert_guide_data, without telling Kodi.
+void Insert(GuideTable& table, std::vector<GuideParser::Channel>& channels)
+{
+    for (auto& channel : channels)
+    {
+        auto& number = channel.number;
+        Guide* guide = table.Find(number);
+        if (!guide)
+        {
+            guide = &table.Insert(number);
+            guide->SetNames(number._guidename, channel.affiliate, channel.imageURL);
+        }
+        for (auto& entry : channel.entries)
+        {
+            guide->AddEntry(entry);
+        }
+        table.QueueAgeOut(number);
+    }
+}
+
+bool Parse(const std::string& json, GuideTable& table)
+{
+    GuideParser parser;
+    if (!parser.Feed(json.data(), json.size()) || !parser.Finish())
+        return false;
+    Insert(table, parser.Channels());
+    return true;
+}
+
+// PVR_HDHR::SaveSnapshot and _load_snapshot, for the guide.
+void Save(const GuideTable& table, SnapshotWriter& w)
+{
+    w.Put(static_cast<uint32_t>(table.Size()));
+    for (size_t i = 0; i < table.Size(); i++)
+    {
+        w.Put(table.ID(i));
+        table.At(i).Save(w);
+    }
+}
+
+bool Load(SnapshotReader& r, GuideTable& table)
+{
+    uint32_t count;
+    if (!r.Count(count))
+        return false;
+    for (uint32_t n = 0; n < count; n++)
+    {
+        uint32_t id;
+        if (!r.Get(id) || !table.Insert(id).Load(r))
+            return false;
+        table.QueueAgeOut(id);
+    }
+    return r.AtEnd();
+}
+
+size_t Entries(const GuideTable& table)
+{
+    size_t entries = 0;
+    for (size_t i = 0; i < table.Size(); i++)
+    {
+        entries += table.At(i).Size();
+    }
+    return entries;
+}
+
+// Fetched from a local server, so the network costs next to nothing.
+void Cold()
+{
+    const auto json = Test::GuideJSON(Channels, Test::GuideStart, Basic);
+    Test::LocalServer server([&](const std::string&) { return Test::Response::Ok(json); });
+
+    auto start = Clock::now();
+    GuideTable  table;
+    GuideParser parser;
+    CHECK(StreamFileContents(server.URL("/api/guide.php"), [&](const char* data, size_t size) {
+        return parser.Feed(data, size);
+    }));
+    CHECK(parser.Finish());
+    Insert(table, parser.Channels());
+    auto ms = Milliseconds(start);
+
+    CHECK(table.Size() == Channels);
+    CHECK(Entries(table) == Channels * Basic * 2);
+
+    // One request for each guideExtendedEach of each channel, after the first.
+    time_t each     = g.Settings.guideExtendedEach;
+    size_t requests = Channels * (((Days * 24 - Basic) * 3600 + each - 1) / each);
+    printf("Cold, basic guide of %u channels, %.1f MB: %.1f ms, then %u requests, %.0f minutes, for %d days\n",
+            Channels, json.size() / 1048576.0, ms, static_cast<unsigned>(requests),
+            requests * g.Settings.guideRequestInterval / 60000.0, Days);
+}
+
+void Warm()
+{
+    const std::string path = "SnapshotBench.bin";
+
+    GuideTable saved;
+    CHECK(Parse(Test::GuideJSON(Channels, Test::GuideStart, Days * 24), saved));
+
+    SnapshotWriter w;
+    Save(saved, w);
+    {
+        std::ofstream file(path, std::ios::binary);
+        file << SnapshotHeader(w.Data()) << w.Data();
+    }
+
+    // ReadSnapshotFile and _load_snapshot
+    auto start = Clock::now();
+    std::string contents, payload;
+    {
+        std::ifstream file(path, std::ios::binary);
+        std::stringstream ss;
+        ss << file.rdbuf();
+        contents = ss.str();
+    }
+    GuideTable table;
+    CHECK(UnpackSnapshot(path, contents, payload));
+    SnapshotReader r(payload);
+    CHECK(Load(r, table));
+    auto ms = Milliseconds(start);
+    remove(path.c_str());
+
+    printf("Warm, %d days of %u channels, %.1f MB: %.1f ms\n",
+            Days, Channels, contents.size() / 1048576.0, ms);
+
+    // Saved again, it is the same.
+    CHECK(Entries(table) == Channels * Days * 24 * 2);
+    SnapshotWriter again;
+    Save(table, again);
+    CHECK(again.Data() == w.Data());
+
+    // A damaged file is not loaded.
+    contents[contents.size() / 2] ^= 1;
+    CHECK(!UnpackSnapshot(path, contents, payload));
+}
+
+} // namespace
+
+int main()
+{
+    Cold();
+    Warm();
+    return Test::Result();
+}
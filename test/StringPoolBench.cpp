@@ -0,0 +1,193 @@
+/*
+ *      Copyright (C) 2017-2019 Matthew Lundberg <matthew.k.lundberg@gmail.com>
+ *      https://github.com/MatthewLundberg/pvr.hdhomerun
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+
+// Heap used by the text of a guide's entries, with the repeated fields
+// pooled and, as before the pool, with every field a std::string of its own.
+// Linux only, the heap is measured with malloc_usable_size.
+
+#include "Entry.h"
+#include "GuideData.h"
+#include "GuideParser.h"
+#include "StringPool.h"
+#include "Test.h"
+
+#include <malloc.h>
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+using namespace PVRHDHomeRun;
+
+namespace
+{
+std::atomic<size_t> live{0}; // Bytes
+}
+
+void* operator new(size_t n)
+{
+    if (void* p = malloc(n ? n : 1))
+    {
+        live += malloc_usable_size(p);
+        return p;
+    }
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept
+{
+    if (p)
+        live -= malloc_usable_size(p);
+    free(p);
+}
+void operator delete(void* p, size_t) noexcept
+{
+    operator delete(p);
+}
+
+namespace
+{
+
+// Entry before the pool.
+struct PlainEntry
+{
+    time_t      _starttime       = 0;
+    time_t      _endtime         = 0;
+    time_t      _originalairdate = 0;
+    int         _season          = 0;
+    int         _episode         = 0;
+    std::string _episodenumber;
+    std::string _episodetitle;
+    std::string _title;
+    std::string _synopsis;
+    std::string _imageURL;
+    std::string _posterURL;
+    std::string _seriesID;
+    uint32_t    _genre = 0;
+};
+
+PlainEntry Plain(const Entry& e)
+{
+    PlainEntry p;
+    p._starttime       = e._starttime;
+    p._endtime         = e._endtime;
+    p._originalairdate = e._originalairdate;
+    p._season          = e._season;
+    p._episode         = e._episode;
+    p._episodenumber   = e._episodenumber;
+    p._episodetitle    = e._episodetitle;
+    p._title           = e._title;
+    p._synopsis        = e._synopsis;
+    p._imageURL        = e._imageURL;
+    p._posterURL       = e._posterURL;
+    p._seriesID        = e._seriesID;
+    p._genre           = e._genre;
+    return p;
+}
+
+Entry Pooled(const PlainEntry& p)
+{
+    Entry e;
+    e._starttime       = p._starttime;
+    e._endtime         = p._endtime;
+    e._originalairdate = p._originalairdate;
+    e._season          = p._season;
+    e._episode         = p._episode;
+    e._episodenumber   = p._episodenumber;
+    e._episodetitle    = p._episodetitle;
+    e._title           = p._title;
+    e._synopsis        = p._synopsis;
+    e._imageURL        = p._imageURL;
+    e._posterURL       = p._posterURL;
+    e._seriesID        = p._seriesID;
+    e._genre           = p._genre;
+    return e;
+}
+
+double MB(size_t bytes)
+{
+    return bytes / 1048576.0;
+}
+
+} // namespace
+
+int main()
+{
+    const unsigned channels = 300;
+    const int      days     = 7;
+
+    std::vector<PlainEntry> plain;
+    size_t plain_bytes;
+    {
+        GuideParser parser;
+        {
+            auto json = Test::GuideJSON(channels, Test::GuideStart, days * 24);
+            CHECK(parser.Feed(json.data(), json.size()) && parser.Finish());
+        }
+
+        size_t count = 0;
+        for (auto& channel : parser.Channels())
+        {
+            count += channel.entries.size();
+        }
+
+        size_t before = live;
+        plain.reserve(count);
+        for (auto& channel : parser.Channels())
+        {
+            for (auto& entry : channel.entries)
+            {
+                plain.push_back(Plain(entry));
+            }
+        }
+        plain_bytes = live - before;
+    }
+    // Nothing but the entries below holds a pooled string.
+    CHECK(StringPool::GetStats().strings == 0);
+
+    size_t before = live;
+    std::vector<Entry> pooled;
+    pooled.reserve(plain.size());
+    for (auto& p : plain)
+    {
+        pooled.push_back(Pooled(p));
+    }
+    size_t pooled_bytes = live - before;
+    auto   stats        = StringPool::GetStats();
+
+    printf("%u entries, %d days of %u channels\n", static_cast<unsigned>(plain.size()), days, channels);
+    printf("std::string fields: %.1f MB\n", MB(plain_bytes));
+    printf("Pooled fields:      %.1f MB, of which the pool %u strings, %.1f MB of text\n",
+            MB(pooled_bytes), static_cast<unsigned>(stats.strings), MB(stats.bytes));
+
+    CHECK(pooled_bytes < plain_bytes);
+    for (size_t i = 0; i < plain.size(); i++)
+    {
+        CHECK(pooled[i]._title.str() == plain[i]._title && pooled[i]._seriesID.str() == plain[i]._seriesID);
+    }
+
+    // The pool empties with the last handle.
+    pooled.clear();
+    CHECK(StringPool::GetStats().strings == 0);
+    return Test::Result();
+}
@@ -0,0 +1,57 @@
+#pragma once
+/*
+ *      Copyright (C) 2017-2019 Matthew Lundberg <matthew.k.lundberg@gmail.com>
+ *      https://github.com/MatthewLundberg/pvr.hdhomerun
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+
+#include <cstdio>
+
+// Each test is a program which reports its failed checks and exits non-zero
+// if there were any.
+namespace PVRHDHomeRun
+{
+namespace Test
+{
+
+inline int& Failures()
+{
+    static int failures = 0;
+    return failures;
+}
+
+inline int Result()
+{
+    if (Failures())
+        fprintf(stderr, "%d check(s) failed\n", Failures());
+    return Failures() ? 1 : 0;
+}
+
+} // namespace Test
+} // namespace PVRHDHomeRun
+
+#define CHECK(cond)                                                     \
+    do                                                                  \
+    {                                                                   \
+        if (!(cond))                                                    \
+        {                                                               \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            PVRHDHomeRun::Test::Failures()++;                           \
+        }                                                               \
+    } while (0)
@@ -1,5 +1,5 @@
 /*
- *      Copyright (C) 2017-2018 Matthew Lundberg <matthew.k.lundberg@gmail.com>
+ *      Copyright (C) 2017-2019 Matthew Lundberg <matthew.k.lundberg@gmail.com>
  *      https://github.com/MatthewLundberg/pvr.hdhomerun
  *
  *  This Program is free software; you can redistribute it and/or modify
@@ -19,42 +19,15 @@
  *
  */
 
-#include "Info.h"
-#include "Device.h"
+
 #include "Addon.h"
-#include <sstream>
-#include <cstdlib>
 
 namespace PVRHDHomeRun
 {
 
-Info::Info(const Json::Value& v)
-{
-    _guidenumber = v["GuideNumber"].asString();
-    _guidename   = v["GuideName"].asString();
-    _drm         = v["DRM"].asBool();
-    _hd          = v["HD"].asBool();
-}
-
-bool Info::AddDevice(TunerDevice* t, const std::string& url)
-{
-    if (HasDevice(t))
-    {
-        return false;
-    }
-    _tuner_devices.insert(t);
-    _url[t] = url;
-    return true;
-}
-
-bool Info::RemoveDevice(TunerDevice* t)
-{
-    if (!HasDevice(t))
-    {
-        return false;
-    }
-    _tuner_devices.erase(t);
-    return true;
-}
+// Addon.cpp is not linked into the tests.  The settings are the defaults,
+// and there are no Kodi callbacks, so nothing under test may reach g.XBMC
+// or g.PVR other than through KODI_LOG.
+GlobalsType g;
 
 } // namespace PVRHDHomeRun
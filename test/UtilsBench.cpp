@@ -0,0 +1,215 @@
+/*
+ *      Copyright (C) 2017-2019 Matthew Lundberg <matthew.k.lundberg@gmail.com>
+ *      https://github.com/MatthewLundberg/pvr.hdhomerun
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+
+// Allocations and throughput of the per-thread read buffer and JSON reader,
+// on guide-sized payloads, and their reuse by the ParallelFor workers.
+
+#include "HttpClient.h"
+#include "LocalServer.h"
+#include "Test.h"
+#include "Utils.h"
+#include "WorkerPool.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <set>
+#include <thread>
+
+using namespace PVRHDHomeRun;
+
+namespace
+{
+// Allocations are counted on this thread, or on every thread.
+thread_local bool count_here = false;
+std::atomic<bool>   count_all{false};
+std::atomic<size_t> allocations{0};
+}
+
+void* operator new(size_t n)
+{
+    if (count_here || count_all)
+        allocations++;
+    if (void* p = malloc(n ? n : 1))
+        return p;
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept
+{
+    free(p);
+}
+void operator delete(void* p, size_t) noexcept
+{
+    free(p);
+}
+
+namespace
+{
+
+typedef std::chrono::steady_clock Clock;
+
+double Milliseconds(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// A guide.php response of about 'size' bytes.
+std::string Guide(size_t size)
+{
+    std::string s = "[";
+    for (int channel = 0; s.size() < size; channel++)
+    {
+        if (channel)
+            s += ",";
+        s += "{\"GuideNumber\":\"" + std::to_string(channel) + ".1\",\"GuideName\":\"CHAN\",\"Guide\":[";
+        for (int i = 0; i < 48; i++)
+        {
+            if (i)
+                s += ",";
+            s += "{\"StartTime\":" + std::to_string(1546300800 + i*1800)
+              + ",\"EndTime\":" + std::to_string(1546302600 + i*1800)
+              + ",\"Title\":\"Programme title\",\"EpisodeNumber\":\"S01E02\""
+                ",\"Synopsis\":\"A synopsis of some length, as the guide has for most programmes.\""
+                ",\"ImageURL\":\"http://img.hdhomerun.com/titles/C123456ENG.jpg\""
+                ",\"SeriesID\":\"C123456ENG\",\"Filter\":[\"News\"]}";
+        }
+        s += "]}";
+    }
+    return s + "]";
+}
+
+const std::string Small = "{\"DeviceID\":\"1234ABCD\",\"TunerCount\":4,\"LineupURL\":\"http://192.168.1.2/lineup.json\"}";
+
+size_t ParseSmall()
+{
+    Json::Value v;
+    std::string err;
+    size_t before = allocations;
+    CHECK(StringToJson(Small, v, err));
+    return allocations - before;
+}
+
+// The reader is built by the first call on a thread, and reused.
+void Reader()
+{
+    size_t first, second;
+    std::thread([&]() {
+        count_here = true;
+        first  = ParseSmall();
+        second = ParseSmall();
+        count_here = false;
+    }).join();
+
+    printf("StringToJson, small document: %u allocations on a new thread, %u after\n",
+            static_cast<unsigned>(first), static_cast<unsigned>(second));
+    CHECK(second < first);
+}
+
+// The second batch runs on the threads of the first, with their readers.
+void Workers()
+{
+    const size_t count = 16, workers = 4;
+
+    std::mutex             mutex;
+    std::set<std::thread::id> threads[2];
+    size_t                 used[2];
+    for (int batch = 0; batch < 2; batch++)
+    {
+        allocations = 0;
+        count_all   = true;
+        // Long enough for every worker to take some.
+        ParallelFor(count, workers, [&](size_t) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            ParseSmall();
+            std::lock_guard<std::mutex> lock(mutex);
+            threads[batch].insert(std::this_thread::get_id());
+        });
+        count_all  = false;
+        used[batch] = allocations;
+    }
+
+    printf("ParallelFor of %u small documents: %u allocations in the first batch, %u in the second\n",
+            static_cast<unsigned>(count), static_cast<unsigned>(used[0]), static_cast<unsigned>(used[1]));
+    CHECK(used[1] < used[0]);
+    for (auto& id : threads[1])
+    {
+        CHECK(threads[0].count(id));
+    }
+}
+
+void Throughput()
+{
+    const auto guide = Guide(8 << 20);
+    const double mb  = guide.size() / 1048576.0;
+
+    Test::LocalServer server([&](const std::string&) { return Test::Response::Ok(guide); });
+    Test::FallbackCounter fallback;
+    PooledHttpClient      client(fallback);
+
+    std::string body;
+    CHECK(client.Get(server.URL("/guide.php"), body, 0));
+
+    for (int run = 0; run < 2; run++)
+    {
+        count_here = true;
+        allocations = 0;
+        auto start = Clock::now();
+        std::string body;
+        CHECK(client.Get(server.URL("/guide.php"), body, 0));
+        auto ms = Milliseconds(start);
+        size_t used = allocations;
+        count_here = false;
+
+        CHECK(body == guide);
+        printf("Get, %.1f MB: %.1f ms, %.0f MB/s, %u allocations\n",
+                mb, ms, mb / ms * 1000, static_cast<unsigned>(used));
+    }
+
+    size_t received = 0;
+    auto start = Clock::now();
+    CHECK(client.Stream(server.URL("/guide.php"), [&](const char*, size_t n) { received += n; return true; }, 0));
+    auto ms = Milliseconds(start);
+    CHECK(received == guide.size());
+    printf("Stream, %.1f MB: %.1f ms, %.0f MB/s\n", mb, ms, mb / ms * 1000);
+
+    Json::Value v;
+    std::string err;
+    start = Clock::now();
+    CHECK(StringToJson(guide, v, err));
+    ms = Milliseconds(start);
+    printf("StringToJson, %.1f MB: %.1f ms, %.0f MB/s\n", mb, ms, mb / ms * 1000);
+
+    CHECK(fallback.calls == 0);
+}
+
+} // namespace
+
+int main()
+{
+    Reader();
+    Workers();
+    Throughput();
+    WorkerPool::Shared().Stop();
+    return Test::Result();
+}